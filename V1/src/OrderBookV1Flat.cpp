@@ -0,0 +1,180 @@
+#include "OrderBookV1Flat.h"
+#include <algorithm>
+
+OrderBookV1Flat::OrderBookV1Flat() {}
+
+void OrderBookV1Flat::AddOrder(OrderId order_id, Side side, Price price, Quantity quantity) {
+    if (side == Side::BUY) {
+        Match(asks_, side, price, quantity);
+    } else {
+        Match(bids_, side, price, quantity);
+    }
+    if (quantity > 0) {
+        Rest(order_id, side, price, quantity);
+    }
+}
+
+void OrderBookV1Flat::Match(std::vector<Level>& contra, Side side, Price price, Quantity& quantity) {
+    while (quantity > 0 && !contra.empty()) {
+        Level& level = contra.back();
+        bool crosses = (side == Side::BUY) ? price >= level.price : price <= level.price;
+        if (!crosses) {
+            break;
+        }
+
+        while (level.head != NIL && quantity > 0) {
+            Node& node = nodes_[level.head];
+            Quantity trade_quantity = std::min(quantity, node.quantity);
+
+            node.quantity -= trade_quantity;
+            quantity -= trade_quantity;
+
+            if (node.quantity == 0) {
+                Index filled = level.head;
+                level.head = node.next;
+                order_map_.Erase(node.order_id);
+                FreeNode(filled);
+            }
+        }
+        if (level.head == NIL) {
+            contra.pop_back();
+        } else {
+            nodes_[level.head].prev = NIL;
+        }
+    }
+}
+
+void OrderBookV1Flat::Rest(OrderId order_id, Side side, Price price, Quantity quantity) {
+    std::vector<Level>& levels = LevelsOf(side);
+    auto it = FindLevel(levels, side, price);
+    if (it == levels.end() || it->price != price) {
+        it = levels.insert(it, Level{price, NIL, NIL});
+    }
+
+    Index index = NewNode();
+    nodes_[index] = {order_id, price, quantity, NIL, it->tail, side};
+    if (it->tail == NIL) {
+        it->head = index;
+    } else {
+        nodes_[it->tail].next = index;
+    }
+    it->tail = index;
+    order_map_.Insert(order_id, index);
+}
+
+void OrderBookV1Flat::CancelOrder(OrderId order_id) {
+    Index index = order_map_.Find(order_id);
+    if (index == NIL) {
+        return; // Order not found
+    }
+
+    const Node& node = nodes_[index];
+    std::vector<Level>& levels = LevelsOf(node.side);
+    auto it = FindLevel(levels, node.side, node.price);
+
+    if (node.prev != NIL) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        it->head = node.next;
+    }
+    if (node.next != NIL) {
+        nodes_[node.next].prev = node.prev;
+    } else {
+        it->tail = node.prev;
+    }
+    if (it->head == NIL) {
+        levels.erase(it);
+    }
+    order_map_.Erase(order_id);
+    FreeNode(index);
+}
+
+std::vector<OrderBookV1Flat::Level>::iterator
+OrderBookV1Flat::FindLevel(std::vector<Level>& levels, Side side, Price price) {
+    auto better = [side](Price a, Price b) { return side == Side::BUY ? a > b : a < b; };
+    // Most activity is at the inside, so try the last few levels first.
+    auto it = levels.end();
+    for (int i = 0; i < INSIDE_SCAN && it != levels.begin(); ++i) {
+        if (better(price, (it - 1)->price)) {
+            return it;
+        }
+        --it;
+        if (it->price == price) {
+            return it;
+        }
+    }
+    return std::lower_bound(levels.begin(), it, price,
+                            [&](const Level& level, Price p) { return better(p, level.price); });
+}
+
+OrderBookV1Flat::Index OrderBookV1Flat::NewNode() {
+    if (free_nodes_.empty()) {
+        nodes_.emplace_back();
+        return static_cast<Index>(nodes_.size() - 1);
+    }
+    Index index = free_nodes_.back();
+    free_nodes_.pop_back();
+    return index;
+}
+
+void OrderBookV1Flat::FreeNode(Index index) {
+    free_nodes_.push_back(index);
+}
+
+OrderBookV1Flat::IdMap::IdMap()
+    : slots_(1024, Slot{EMPTY, NIL}),
+      mask_(1023),
+      shift_(64 - 10),
+      size_(0) {}
+
+OrderBookV1Flat::Index OrderBookV1Flat::IdMap::Find(OrderId order_id) const {
+    for (size_t i = Home(order_id);; i = (i + 1) & mask_) {
+        if (slots_[i].order_id == order_id) return slots_[i].index;
+        if (slots_[i].order_id == EMPTY) return NIL;
+    }
+}
+
+void OrderBookV1Flat::IdMap::Insert(OrderId order_id, Index index) {
+    if ((size_ + 1) * 4 > slots_.size()) {
+        Grow();
+    }
+    size_t i = Home(order_id);
+    while (slots_[i].order_id != EMPTY && slots_[i].order_id != order_id) {
+        i = (i + 1) & mask_;
+    }
+    if (slots_[i].order_id == EMPTY) {
+        size_++;
+    }
+    slots_[i] = {order_id, index};
+}
+
+void OrderBookV1Flat::IdMap::Erase(OrderId order_id) {
+    size_t i = Home(order_id);
+    while (slots_[i].order_id != order_id) {
+        if (slots_[i].order_id == EMPTY) return;
+        i = (i + 1) & mask_;
+    }
+    // Pull back every later entry of the run whose home is not in (i, j].
+    for (size_t j = (i + 1) & mask_; slots_[j].order_id != EMPTY; j = (j + 1) & mask_) {
+        size_t home = Home(slots_[j].order_id);
+        if (((j - home) & mask_) >= ((j - i) & mask_)) {
+            slots_[i] = slots_[j];
+            i = j;
+        }
+    }
+    slots_[i].order_id = EMPTY;
+    size_--;
+}
+
+void OrderBookV1Flat::IdMap::Grow() {
+    std::vector<Slot> old(slots_.size() * 2, Slot{EMPTY, NIL});
+    old.swap(slots_);
+    mask_ = slots_.size() - 1;
+    shift_--;
+    size_ = 0;
+    for (const Slot& slot : old) {
+        if (slot.order_id != EMPTY) {
+            Insert(slot.order_id, slot.index);
+        }
+    }
+}
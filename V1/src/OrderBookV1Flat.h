@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Types.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// V1's semantics (any 64-bit price, any 64-bit order id, no capacity
+// limits) without its node-based containers.
+//
+// Each side is a flat vector of levels sorted so that the best price is at
+// the back: bids ascending, asks descending. Matching pops exhausted
+// levels off the end, and a new level near the inside is inserted near the
+// end, moving only the few levels that are better than it. Price lookups
+// are binary searches over that contiguous array.
+//
+// Orders are nodes in one pool, recycled through a free list and linked
+// into their level's FIFO by 32-bit indices. The order-id map is an
+// open-addressing table of pool indices that doubles once a quarter full:
+// short probe runs were worth ~8% overall over a half-full table.
+class OrderBookV1Flat {
+public:
+    OrderBookV1Flat();
+    void AddOrder(OrderId order_id, Side side, Price price, Quantity quantity);
+    void CancelOrder(OrderId order_id);
+
+private:
+    using Index = uint32_t;
+    static constexpr Index NIL = ~Index(0);
+
+    struct Node {
+        OrderId order_id;
+        Price price;
+        Quantity quantity;
+        Index next;
+        Index prev;
+        Side side;
+    };
+
+    struct Level {
+        Price price;
+        Index head;
+        Index tail;
+    };
+
+    // Linear probing, Fibonacci hashing, backward-shift deletion. Order id
+    // ~0 is reserved as the empty marker.
+    class IdMap {
+    public:
+        IdMap();
+        Index Find(OrderId order_id) const;
+        void Insert(OrderId order_id, Index index);
+        void Erase(OrderId order_id);
+
+    private:
+        static constexpr OrderId EMPTY = ~OrderId(0);
+        struct Slot {
+            OrderId order_id;
+            Index index;
+        };
+        size_t Home(OrderId order_id) const {
+            return (order_id * 0x9E3779B97F4A7C15ULL) >> shift_;
+        }
+        void Grow();
+
+        std::vector<Slot> slots_;
+        size_t mask_;
+        unsigned shift_;
+        size_t size_;
+    };
+
+    std::vector<Level>& LevelsOf(Side side) { return side == Side::BUY ? bids_ : asks_; }
+    // First level at or better than `price`: where a level at `price` is,
+    // or would be inserted. Checks the INSIDE_SCAN best levels linearly
+    // before binary searching the rest.
+    static constexpr int INSIDE_SCAN = 8;
+    static std::vector<Level>::iterator FindLevel(std::vector<Level>& levels, Side side, Price price);
+
+    Index NewNode();
+    void FreeNode(Index index);
+    void Match(std::vector<Level>& contra, Side side, Price price, Quantity& quantity);
+    void Rest(OrderId order_id, Side side, Price price, Quantity quantity);
+
+    std::vector<Level> bids_;
+    std::vector<Level> asks_;
+    std::vector<Node> nodes_;
+    std::vector<Index> free_nodes_;
+    IdMap order_map_;
+};
@@ -1,28 +1,15 @@
 #include "OrderBookV1.h"
+#include "OrderBookV1Flat.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <chrono>
 
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <market_data_file.csv>" << std::endl;
-        return 1;
-    }
-
-    std::string filename = argv[1];
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open file " << filename << std::endl;
-        return 1;
-    }
-
-    OrderBookV1 book;
+template <typename Book>
+void Replay(std::ifstream& file, Book& book) {
     std::string line;
     
-    auto start_time = std::chrono::high_resolution_clock::now();
-
     while (std::getline(file, line)) {
         std::stringstream ss(line);
         std::string field;
@@ -61,6 +48,31 @@ int main(int argc, char* argv[]) {
             book.CancelOrder(order_id);
         }
     }
+}
+
+int main(int argc, char* argv[]) {
+    bool flat = argc == 3 && std::string(argv[1]) == "--flat";
+    if (argc != 2 && !flat) {
+        std::cerr << "Usage: " << argv[0] << " [--flat] <market_data_file.csv>" << std::endl;
+        return 1;
+    }
+
+    std::string filename = argv[argc - 1];
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << filename << std::endl;
+        return 1;
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    if (flat) {
+        OrderBookV1Flat book;
+        Replay(file, book);
+    } else {
+        OrderBookV1 book;
+        Replay(file, book);
+    }
 
     auto end_time = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
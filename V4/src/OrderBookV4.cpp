@@ -11,69 +11,61 @@ OrderBookV4::OrderBookV4()
 
 void OrderBookV4::AddOrder(OrderId order_id, Side side, Price price, Quantity quantity) {
     if (side == Side::BUY) {
-        while (quantity > 0 && price >= best_ask_ && best_ask_ < MAX_PRICE) {
-            PriceLevel_V4& level = asks_[best_ask_];
-            if (level.head == nullptr) { UpdateBestAsk(); continue; }
+        AddOrder<Side::BUY>(order_id, price, quantity);
+    } else {
+        AddOrder<Side::SELL>(order_id, price, quantity);
+    }
+}
 
-            HP_Order_V4* current_order = level.head;
-            while (current_order && quantity > 0) {
-                Quantity trade_quantity = std::min(quantity, current_order->quantity);
-                current_order->quantity -= trade_quantity;
-                quantity -= trade_quantity;
-                level.total_quantity -= trade_quantity;
-                if (current_order->quantity == 0) {
-                    HP_Order_V4* next_order = current_order->next;
-                    order_map_[current_order->order_id] = nullptr;
-                    RemoveFromList(current_order);
-                    order_pool_.DeleteOrder(current_order);
-                    current_order = next_order;
-                }
-            }
-            if (level.head == nullptr) UpdateBestAsk();
-        }
+// One body for both sides: S picks the contra side's levels and best price
+// at compile time, so each instantiation has only the branches of the
+// original per-side code.
+template <Side S>
+void OrderBookV4::AddOrder(OrderId order_id, Price price, Quantity quantity) {
+    constexpr bool is_buy = (S == Side::BUY);
+    constexpr Side CONTRA = is_buy ? Side::SELL : Side::BUY;
+    std::vector<PriceLevel_V4>& contra = LevelsOf<CONTRA>();
+    Price& contra_best = is_buy ? best_ask_ : best_bid_;
+    auto crossed = [&] {
+        return is_buy ? (price >= best_ask_ && best_ask_ < MAX_PRICE)
+                      : (price <= best_bid_ && best_bid_ > 0);
+    };
+    auto update_contra_best = [this] {
+        if (is_buy) UpdateBestAsk();
+        else UpdateBestBid();
+    };
 
-        if (quantity > 0) {
-            HP_Order_V4* new_order = order_pool_.NewOrder();
-            new_order->order_id = order_id;
-            new_order->quantity = quantity;
-            new_order->price = price;
-            new_order->side = Side::BUY;
-            AddToList(price, new_order);
-            order_map_[order_id] = new_order;
-            if (price > best_bid_) best_bid_ = price;
-        }
-    } else { // Side::SELL
-        while (quantity > 0 && price <= best_bid_ && best_bid_ > 0) {
-            PriceLevel_V4& level = bids_[best_bid_];
-            if (level.head == nullptr) { UpdateBestBid(); continue; }
+    while (quantity > 0 && crossed()) {
+        PriceLevel_V4& level = contra[contra_best];
+        if (level.head == nullptr) { update_contra_best(); continue; }
 
-            HP_Order_V4* current_order = level.head;
-            while (current_order && quantity > 0) {
-                Quantity trade_quantity = std::min(quantity, current_order->quantity);
-                current_order->quantity -= trade_quantity;
-                quantity -= trade_quantity;
-                level.total_quantity -= trade_quantity;
-                if (current_order->quantity == 0) {
-                    HP_Order_V4* next_order = current_order->next;
-                    order_map_[current_order->order_id] = nullptr;
-                    RemoveFromList(current_order);
-                    order_pool_.DeleteOrder(current_order);
-                    current_order = next_order;
-                }
+        HP_Order_V4* current_order = level.head;
+        while (current_order && quantity > 0) {
+            Quantity trade_quantity = std::min(quantity, current_order->quantity);
+            current_order->quantity -= trade_quantity;
+            quantity -= trade_quantity;
+            level.total_quantity -= trade_quantity;
+            if (current_order->quantity == 0) {
+                HP_Order_V4* next_order = current_order->next;
+                order_map_[current_order->order_id] = nullptr;
+                RemoveFromList<CONTRA>(current_order);
+                order_pool_.DeleteOrder(current_order);
+                current_order = next_order;
             }
-            if (level.head == nullptr) UpdateBestBid();
         }
+        if (level.head == nullptr) update_contra_best();
+    }
 
-        if (quantity > 0) {
-            HP_Order_V4* new_order = order_pool_.NewOrder();
-            new_order->order_id = order_id;
-            new_order->quantity = quantity;
-            new_order->price = price;
-            new_order->side = Side::SELL;
-            AddToList(price, new_order);
-            order_map_[order_id] = new_order;
-            if (price < best_ask_) best_ask_ = price;
-        }
+    if (quantity > 0) {
+        HP_Order_V4* new_order = order_pool_.NewOrder();
+        new_order->order_id = order_id;
+        new_order->quantity = quantity;
+        new_order->price = price;
+        new_order->side = S;
+        AddToList<S>(price, new_order);
+        order_map_[order_id] = new_order;
+        if (is_buy && price > best_bid_) best_bid_ = price;
+        if (!is_buy && price < best_ask_) best_ask_ = price;
     }
 }
 
@@ -82,22 +74,31 @@ void OrderBookV4::CancelOrder(OrderId order_id) {
     HP_Order_V4* order = order_map_[order_id];
     if (order == nullptr) return;
 
+    if (order->side == Side::BUY) {
+        CancelOrder<Side::BUY>(order);
+    } else {
+        CancelOrder<Side::SELL>(order);
+    }
+}
+
+template <Side S>
+void OrderBookV4::CancelOrder(HP_Order_V4* order) {
     Price price = order->price;
-    Side side = order->side;
 
-    RemoveFromList(order);
-    order_map_[order_id] = nullptr;
+    RemoveFromList<S>(order);
+    order_map_[order->order_id] = nullptr;
     order_pool_.DeleteOrder(order);
 
-    if (side == Side::BUY && bids_[price].head == nullptr && price == best_bid_) {
-        UpdateBestBid();
-    } else if (side == Side::SELL && asks_[price].head == nullptr && price == best_ask_) {
-        UpdateBestAsk();
-    }
+    if (LevelsOf<S>()[price].head != nullptr) return;
+    if (S == Side::BUY && price == best_bid_) UpdateBestBid();
+    if (S == Side::SELL && price == best_ask_) UpdateBestAsk();
 }
 
+// Like AddOrder, these take the side as a template parameter rather than
+// reading order->side, so neither branches on it.
+template <Side S>
 void OrderBookV4::AddToList(Price price, HP_Order_V4* order) {
-    auto& level = (order->side == Side::BUY) ? bids_[price] : asks_[price];
+    PriceLevel_V4& level = LevelsOf<S>()[price];
     if (level.head == nullptr) {
         level.head = level.tail = order;
     } else {
@@ -108,8 +109,9 @@ void OrderBookV4::AddToList(Price price, HP_Order_V4* order) {
     level.total_quantity += order->quantity;
 }
 
+template <Side S>
 void OrderBookV4::RemoveFromList(HP_Order_V4* order) {
-    auto& level = (order->side == Side::BUY) ? bids_[order->price] : asks_[order->price];
+    PriceLevel_V4& level = LevelsOf<S>()[order->price];
     if (order->prev) order->prev->next = order->next;
     if (order->next) order->next->prev = order->prev;
     if (level.head == order) level.head = order->next;
@@ -27,7 +27,16 @@ public:
     void CancelOrder(OrderId order_id);
 
 private:
+    template <Side S>
+    void AddOrder(OrderId order_id, Price price, Quantity quantity);
+    template <Side S>
+    void CancelOrder(HP_Order_V4* order);
+    // The level array of side S, picked at compile time.
+    template <Side S>
+    std::vector<PriceLevel_V4>& LevelsOf() { return S == Side::BUY ? bids_ : asks_; }
+    template <Side S>
     void AddToList(Price price, HP_Order_V4* order);
+    template <Side S>
     void RemoveFromList(HP_Order_V4* order);
     void UpdateBestBid();
     void UpdateBestAsk();
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "BookTraits.h"
+#include "HP_Types.h"
+#include "MemoryFootprint.h"
+#include "PriceBitmap.h"
+#include <vector>
+
+// Re-use V4's order struct for simplicity
+// using HP_Order_V6 = HP_Order_V4;
+// using PriceLevel_V6 = PriceLevel_V4;
+
+// V6 needs the V4-style struct that includes price/side for fast
+// cancellation; its widths come from the book's traits (BookTraits.h).
+template <typename BookTraits> struct BasicOrder_V6 {
+  using Price = typename BookTraits::Price;
+  using Quantity = typename BookTraits::Quantity;
+  using OrderId = typename BookTraits::OrderId;
+
+  // A lazily cancelled order keeps its node as a tombstone but gives up
+  // its id: the id is already out of the index and may be resting again on
+  // a new order, so whatever frees the tombstone must not erase it a
+  // second time.
+  static constexpr OrderId TOMBSTONE_ID = ~OrderId(0);
+
+  OrderId order_id;
+  Quantity quantity;
+  Price price;
+  Side side;
+  uint32_t timer = 0; // TimerWheel handle of a DAY/GTD order; fills padding
+  BasicOrder_V6 *next = nullptr;
+  BasicOrder_V6 *prev = nullptr;
+};
+
+template <typename BookTraits> struct BasicPriceLevel_V6 {
+  using Quantity = typename BookTraits::Quantity;
+
+  Quantity total_quantity = 0;
+  BasicOrder_V6<BookTraits> *head = nullptr;
+  BasicOrder_V6<BookTraits> *tail = nullptr;
+};
+
+using HP_Order_V6 = BasicOrder_V6<DefaultBookTraits>;
+using PriceLevel_V6 = BasicPriceLevel_V6<DefaultBookTraits>;
+static_assert(sizeof(HP_Order_V6) == 40, "the timer handle must not grow orders");
+
+constexpr size_t HOT_LEVELS = 4;
+
+// The best HOT_LEVELS levels of one side, best first, packed into a single
+// cache line so the inside of the book can be read and updated without
+// touching the level array. `head` is the level's first order.
+template <typename BookTraits> struct alignas(64) BasicHotLevels {
+  typename BookTraits::Price price[HOT_LEVELS];
+  typename BookTraits::Quantity quantity[HOT_LEVELS];
+  BasicOrder_V6<BookTraits> *head[HOT_LEVELS] = {};
+};
+using HotLevels = BasicHotLevels<DefaultBookTraits>;
+static_assert(sizeof(HotLevels) == 64, "HotLevels must fill one cache line");
+static_assert(sizeof(BasicHotLevels<SmallTickBookTraits>) == 64,
+              "HotLevels must fill one cache line");
+
+// Everything that differs between the bid and the ask side, resolved at
+// compile time. Bids improve upwards and are scanned with clz from the high
+// end of a bitmap word; asks improve downwards and are scanned with ctz.
+// EMPTY is the best price a side reports when it holds no orders; the ask
+// side's is the traits' PRICE_LIMIT, at or above any price_limit a
+// BookSizing can give that book.
+template <Side S, typename BookTraits = DefaultBookTraits> struct SideTraits;
+
+template <typename BookTraits> struct SideTraits<Side::BUY, BookTraits> {
+  using Price = typename BookTraits::Price;
+  static constexpr Side OPPOSITE = Side::SELL;
+  static constexpr Price EMPTY = 0;
+
+  static bool Better(Price a, Price b) { return a > b; }
+  // The adjacent price one step away from the inside.
+  static Price Behind(Price p) { return p - 1; }
+  // Best non-empty price at or behind `from`.
+  template <typename Bitmap>
+  static Price Scan(const Bitmap &bitmap, Price from) {
+    return scan_down(bitmap, from, EMPTY);
+  }
+  // Bits of p's word at p or behind it.
+  static uint64_t MaskFrom(Price p) {
+    uint64_t mask = (1ULL << (p & 63)) - 1;
+    return mask | (1ULL << (p & 63));
+  }
+  static unsigned BestBit(uint64_t chunk) { return 63 - BUILTIN_CLZLL(chunk); }
+  // Moves to the next word behind, out of `words`; false when there is none.
+  static bool NextWord(size_t &index, size_t) {
+    if (index == 0) return false;
+    index--;
+    return true;
+  }
+};
+
+template <typename BookTraits> struct SideTraits<Side::SELL, BookTraits> {
+  using Price = typename BookTraits::Price;
+  static constexpr Side OPPOSITE = Side::BUY;
+  static constexpr Price EMPTY = BookTraits::PRICE_LIMIT;
+
+  static bool Better(Price a, Price b) { return a < b; }
+  static Price Behind(Price p) { return p + 1; }
+  template <typename Bitmap>
+  static Price Scan(const Bitmap &bitmap, Price from) {
+    return scan_up(bitmap, from, EMPTY);
+  }
+  static uint64_t MaskFrom(Price p) { return ~((1ULL << (p & 63)) - 1); }
+  static unsigned BestBit(uint64_t chunk) { return BUILTIN_CTZLL(chunk); }
+  static bool NextWord(size_t &index, size_t words) { return ++index < words; }
+};
+
+// One side of the book: the level array indexed by price, its occupancy
+// bitmap, the optional hot window over its best levels and the best price.
+// The book instantiates one per side, so no list or BBO operation ever
+// branches on the order's side. The arrays come from the traits' Storage
+// and are bounded by its PRICE_LIMIT.
+template <Side S, typename BookTraits = DefaultBookTraits> struct BookSide {
+  using Traits = SideTraits<S, BookTraits>;
+  using Price = typename BookTraits::Price;
+  using Order = BasicOrder_V6<BookTraits>;
+  using Level = BasicPriceLevel_V6<BookTraits>;
+  static constexpr size_t LEVELS = size_t(BookTraits::PRICE_LIMIT) + 1;
+  static constexpr size_t BITMAP_SIZE = BitmapWords(BookTraits::PRICE_LIMIT);
+  template <typename T, size_t N>
+  using Array = typename BookTraits::Storage::template Array<T, N>;
+
+  // Levels for prices [0, price_limit]; price_limit is at most the traits'
+  // PRICE_LIMIT.
+  explicit BookSide(Price price_limit)
+      : levels(price_limit + 1), bitmap(BitmapWords(price_limit)),
+        tombstones(BitmapWords(price_limit)), hot_enabled(false),
+        hot_count(0), best(Traits::EMPTY) {}
+
+  // True if an order from the other side priced at `price` can trade here.
+  bool CrossedBy(Price price) const {
+    return best != Traits::EMPTY && !Traits::Better(price, best);
+  }
+
+  // Keeps `best` (and the hot window, if enabled) current after
+  // levels[price] changed. Call it after the bitmap has been updated. A level
+  // is empty once its total_quantity is 0, even if cancelled orders are
+  // still linked into it.
+  void LevelChanged(Price price) {
+    if (hot_enabled) {
+      SyncHot(price);
+    } else if (levels[price].total_quantity == 0) {
+      if (price == best) UpdateBest();
+    } else if (Traits::Better(price, best)) {
+      best = price;
+    }
+  }
+
+  void UpdateBest() { best = Traits::Scan(bitmap, best); }
+
+  void EnableHot() {
+    hot_enabled = true;
+    hot_count = 0;
+    FillHot(best);
+  }
+
+  // The hot window always holds the best hot_count levels with no gaps: a
+  // level behind the last cached one is left out, and the window is
+  // refilled from the bitmap only when it has drained completely, so
+  // removing the best level is normally a shift within one cache line
+  // rather than a bitmap scan.
+  void SyncHot(Price price) {
+    if (hot_count > 0 && Traits::Better(hot.price[hot_count - 1], price)) return;
+    const Level &level = levels[price];
+    size_t i = 0;
+    while (i < hot_count && Traits::Better(hot.price[i], price)) i++;
+
+    if (i < hot_count && hot.price[i] == price) {
+      if (level.total_quantity != 0) {
+        hot.quantity[i] = level.total_quantity;
+        hot.head[i] = level.head;
+        return;
+      }
+      for (; i + 1 < hot_count; ++i) {
+        hot.price[i] = hot.price[i + 1];
+        hot.quantity[i] = hot.quantity[i + 1];
+        hot.head[i] = hot.head[i + 1];
+      }
+      if (--hot_count == 0 && price != Traits::EMPTY) {
+        FillHot(Traits::Behind(price));
+      }
+    } else {
+      if (level.total_quantity == 0 || (i == hot_count && hot_count > 0)) {
+        return;
+      }
+      if (hot_count < HOT_LEVELS) hot_count++;
+      for (size_t j = hot_count - 1; j > i; --j) {
+        hot.price[j] = hot.price[j - 1];
+        hot.quantity[j] = hot.quantity[j - 1];
+        hot.head[j] = hot.head[j - 1];
+      }
+      hot.price[i] = price;
+      hot.quantity[i] = level.total_quantity;
+      hot.head[i] = level.head;
+    }
+    best = hot_count ? hot.price[0] : Traits::EMPTY;
+  }
+
+  // Appends the levels at or behind `from` until the window is full.
+  void FillHot(Price from) {
+    Price next = from;
+    while (hot_count < HOT_LEVELS && next != Traits::EMPTY) {
+      next = Traits::Scan(bitmap, next);
+      if (next == Traits::EMPTY) break;
+      hot.price[hot_count] = next;
+      hot.quantity[hot_count] = levels[next].total_quantity;
+      hot.head[hot_count] = levels[next].head;
+      hot_count++;
+      next = Traits::Behind(next);
+    }
+  }
+
+  void AddToList(Price price, Order *order) {
+    Level &level = levels[price];
+    if (level.head == nullptr) {
+      level.head = level.tail = order;
+    } else {
+      level.tail->next = order;
+      order->prev = level.tail;
+      level.tail = order;
+    }
+    level.total_quantity += order->quantity;
+  }
+
+  void RemoveFromList(Order *order) {
+    Level &level = levels[order->price];
+    if (order->prev) order->prev->next = order->next;
+    if (order->next) order->next->prev = order->prev;
+    if (level.head == order) level.head = order->next;
+    if (level.tail == order) level.tail = order->prev;
+    level.total_quantity -= order->quantity;
+    order->next = order->prev = nullptr;
+  }
+
+  // On the heap, zero pages until a price is first used: a side that only
+  // ever sees a narrow band of prices keeps the rest of the array unbacked.
+  Array<Level, LEVELS> levels;
+  Array<uint64_t, BITMAP_SIZE> bitmap;
+  // Levels that may hold lazily cancelled orders, for Compact().
+  Array<uint64_t, BITMAP_SIZE> tombstones;
+  bool hot_enabled;
+  BasicHotLevels<BookTraits> hot;
+  size_t hot_count;
+  Price best;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "HP_Types.h"
+#include "MemoryFootprint.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unistd.h>
+
+// Compile-time shape of a BasicOrderBookV6 (its BookTraits parameter): the
+// widths of its prices, quantities and order ids, the price range and
+// order-id capacity its defaults are built for, and where its
+// price-indexed arrays (levels, bitmaps, auction scratch) live. Stops,
+// fills, depth snapshots and the state hash carry the default widths, so a
+// book's types may be narrower than those but not wider.
+
+// Arrays reserved on construction for BookSizing::price_limit and backed a
+// page at a time as prices are used (LazyArray).
+struct HeapStorage {
+  template <typename T, size_t N> using Array = LazyArray<T>;
+};
+
+// std::array of the full range, inside the book object: no pointer to load
+// before indexing, at the cost of a book as large as its arrays (allocate
+// it with new) that is written in full when it is built.
+template <typename T, size_t N> class InlineArray {
+public:
+  // Always N entries; `size` (from BookSizing) must not exceed it.
+  explicit InlineArray(size_t) : data_() {}
+
+  T &operator[](size_t i) { return data_[i]; }
+  const T &operator[](size_t i) const { return data_[i]; }
+  T *data() { return data_.data(); }
+  const T *data() const { return data_.data(); }
+  size_t size() const { return N; }
+  size_t Bytes() const { return sizeof(data_); }
+
+  // A heap-allocated book's pages may not be backed yet; write one byte
+  // per page, as LazyArray::Prefault does.
+  void Prefault() {
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    volatile char *bytes = reinterpret_cast<volatile char *>(data_.data());
+    for (size_t offset = 0; offset < Bytes(); offset += page) {
+      bytes[offset] = bytes[offset];
+    }
+  }
+
+private:
+  std::array<T, N> data_;
+};
+
+struct InlineStorage {
+  template <typename T, size_t N> using Array = InlineArray<T, N>;
+};
+
+// The shape of OrderBookV6 and the other aliases: the HP_Types.h widths
+// and limits, on the heap.
+struct DefaultBookTraits {
+  using Price = ::Price;
+  using Quantity = ::Quantity;
+  using OrderId = ::OrderId;
+  static constexpr Price PRICE_LIMIT = MAX_PRICE;
+  static constexpr OrderId ORDER_ID_LIMIT = MAX_ORDER_ID;
+  using Storage = HeapStorage;
+};
+
+// A small-tick instrument: 4096 price levels and 64k order ids, with
+// 16-bit prices, 32-bit ids and every price-indexed array inline.
+struct SmallTickBookTraits {
+  using Price = uint16_t;
+  using Quantity = uint32_t;
+  using OrderId = uint32_t;
+  static constexpr Price PRICE_LIMIT = 4096;
+  static constexpr OrderId ORDER_ID_LIMIT = OrderId(1) << 16;
+  using Storage = InlineStorage;
+};
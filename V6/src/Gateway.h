@@ -0,0 +1,386 @@
+#pragma once
+
+// Order-entry front end for OrderBookV6: many client connections, a few
+// reactor threads and one matcher thread. Needs C++20 (coroutines).
+//
+// Each connection is a Session driven by a coroutine (RunSession) that
+// reads a request, risk-checks it, submits it to the matcher and writes
+// the ack, suspending whenever the socket would block or the matcher
+// hasn't answered yet. A GatewayReactor owns an epoll set with its sessions
+// (edge-triggered; a session only waits after a read or write returned
+// EAGAIN) plus an eventfd the matcher rings when acks are ready. Every
+// reactor submits into one MpscQueue feeding the GatewayMatcher thread,
+// which owns the book and returns acks through a per-reactor SpscQueue.
+// A session has at most one request in the matcher at a time.
+
+#include "OrderBookV6.h"
+#include "Queues.h"
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Wire format, native endian: fixed-size records in both directions.
+struct OrderRequest {
+  uint64_t client_tag; // echoed in the ack
+  OrderId order_id;    // cancels: the id from this session's add's ack
+  Price price;
+  Quantity quantity;
+  char type; // 'A' add, 'C' cancel
+  Side side;
+};
+
+enum class AckStatus : uint8_t { ACCEPTED, REJECTED };
+
+struct OrderAck {
+  uint64_t client_tag;
+  OrderId order_id; // assigned by the matcher to accepted adds
+  AckStatus status;
+};
+
+// Checks a session makes before anything reaches the matcher. Cancels pass;
+// whether the order is the session's own is checked by the matcher, which
+// records who added it.
+struct RiskLimits {
+  Quantity max_quantity = 10000;
+  Price min_price = 1;
+  Price max_price = MAX_PRICE - 1;
+
+  bool Allows(const OrderRequest &request) const {
+    if (request.type == 'C') return true;
+    return request.type == 'A' && request.quantity > 0 &&
+           request.quantity <= max_quantity && request.price >= min_price &&
+           request.price <= max_price;
+  }
+};
+
+// Fire-and-forget coroutine: starts at once, frees itself when it ends.
+struct SessionTask {
+  struct promise_type {
+    SessionTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+class GatewayReactor;
+
+struct Session {
+  int fd;
+  GatewayReactor *reactor;
+  std::coroutine_handle<> io_waiter;  // resumed on socket readiness
+  std::coroutine_handle<> ack_waiter; // resumed when the matcher answers
+  OrderAck ack;
+};
+
+struct MatcherCommand {
+  Session *session;
+  OrderRequest request;
+};
+
+struct MatcherResult {
+  Session *session;
+  OrderAck ack;
+};
+
+class GatewayReactor {
+public:
+  static constexpr size_t MAX_SESSIONS = 16384;
+
+  GatewayReactor() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ == -1 || event_fd_ == -1) {
+      perror("epoll/eventfd");
+      return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr; // the eventfd
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event);
+  }
+
+  ~GatewayReactor() {
+    if (epoll_fd_ != -1) close(epoll_fd_);
+    if (event_fd_ != -1) close(event_fd_);
+  }
+
+  bool Ok() const { return epoll_fd_ != -1 && event_fd_ != -1; }
+
+  // Registers a non-blocking, connected socket and returns its session;
+  // the caller starts the coroutine. Call before Run, or from its thread.
+  Session *Add(int fd) {
+    if (sessions_.size() == MAX_SESSIONS) return nullptr;
+    sessions_.push_back(std::make_unique<Session>());
+    Session *session = sessions_.back().get();
+    session->fd = fd;
+    session->reactor = this;
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = session;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == -1) {
+      perror("epoll_ctl");
+      sessions_.pop_back();
+      return nullptr;
+    }
+    ++live_sessions_;
+    return session;
+  }
+
+  // A session's coroutine calls this as it ends; closing the fd drops it
+  // from the epoll set. The Session itself lives as long as the reactor,
+  // so events already fetched for it stay safe to look at.
+  void Close(Session &session) {
+    close(session.fd);
+    session.fd = -1;
+    --live_sessions_;
+  }
+
+  // Dispatches socket readiness and acks until every session has ended.
+  void Run() {
+    epoll_event events[256];
+    while (live_sessions_ > 0) {
+      int count = epoll_wait(epoll_fd_, events, 256, 100);
+      for (int i = 0; i < count; ++i) {
+        auto *session = static_cast<Session *>(events[i].data.ptr);
+        if (session == nullptr) {
+          DrainAcks();
+        } else if (session->io_waiter) {
+          std::exchange(session->io_waiter, nullptr).resume();
+        }
+      }
+    }
+  }
+
+  // Matcher side.
+  SpscQueue<MatcherResult, MAX_SESSIONS> &Completions() { return acks_; }
+  void Notify() {
+    uint64_t one = 1;
+    if (write(event_fd_, &one, sizeof one) < 0 && errno != EAGAIN) {
+      perror("eventfd write");
+    }
+  }
+
+private:
+  friend class GatewayMatcher;
+
+  void DrainAcks() {
+    uint64_t count;
+    if (read(event_fd_, &count, sizeof count) < 0 && errno != EAGAIN) {
+      perror("eventfd read");
+    }
+    MatcherResult result;
+    while (acks_.TryPop(result)) {
+      result.session->ack = result.ack;
+      std::exchange(result.session->ack_waiter, nullptr).resume();
+    }
+  }
+
+  int epoll_fd_ = -1;
+  int event_fd_ = -1;
+  size_t live_sessions_ = 0;
+  std::vector<std::unique_ptr<Session>> sessions_;
+  SpscQueue<MatcherResult, MAX_SESSIONS> acks_;
+  bool ack_pending_ = false; // matcher thread only: Notify due
+};
+
+// Owns the book and the thread that applies every session's requests, in
+// the order they reach the queue. Adds are given sequential order ids, and
+// an order can only be cancelled by the session that added it.
+class GatewayMatcher {
+public:
+  static constexpr size_t QUEUE_SIZE = 16384;
+  static constexpr size_t NOTIFY_BATCH = 64; // ring eventfds at least this often
+
+  explicit GatewayMatcher(const std::vector<GatewayReactor *> &reactors)
+      : reactors_(reactors), book_(std::make_unique<OrderBookV6>()) {}
+
+  void Start() {
+    thread_ = std::thread([this]() { Loop(); });
+  }
+
+  // Lets the thread finish once the queue is empty.
+  void Stop() {
+    stop_.store(true, std::memory_order_release);
+    if (thread_.joinable()) thread_.join();
+  }
+
+  ~GatewayMatcher() { Stop(); }
+
+  // Reactor side; waits while the queue is full.
+  void Submit(const MatcherCommand &command) {
+    for (Backoff backoff; !queue_.TryPush(command);) backoff.Wait();
+  }
+
+  const OrderBookV6 &Book() const { return *book_; }
+  uint64_t Processed() const { return processed_; }
+
+private:
+  void Loop() {
+    Backoff backoff;
+    MatcherCommand command;
+    for (;;) {
+      size_t batch = 0;
+      while (batch < NOTIFY_BATCH && queue_.TryPop(command)) {
+        Execute(command);
+        ++batch;
+      }
+      if (batch > 0) {
+        for (GatewayReactor *reactor : reactors_) {
+          if (reactor->ack_pending_) reactor->Notify();
+          reactor->ack_pending_ = false;
+        }
+        backoff = Backoff();
+      } else if (stop_.load(std::memory_order_acquire)) {
+        return;
+      } else {
+        backoff.Wait();
+      }
+    }
+  }
+
+  void Execute(const MatcherCommand &command) {
+    const OrderRequest &request = command.request;
+    OrderAck ack{request.client_tag, request.order_id, AckStatus::ACCEPTED};
+    if (request.type == 'A' && next_order_id_ < MAX_ORDER_ID) {
+      ack.order_id = next_order_id_++;
+      owners_[ack.order_id] = command.session;
+      book_->AddOrder(ack.order_id, request.side, request.price,
+                      request.quantity);
+    } else if (request.type == 'C' && request.order_id > 0 &&
+               request.order_id < next_order_id_ &&
+               owners_[request.order_id] == command.session) {
+      book_->CancelOrder(request.order_id);
+    } else {
+      ack.status = AckStatus::REJECTED;
+    }
+    ++processed_;
+    GatewayReactor *reactor = command.session->reactor;
+    for (Backoff backoff;
+         !reactor->Completions().TryPush({command.session, ack});) {
+      backoff.Wait();
+    }
+    reactor->ack_pending_ = true;
+  }
+
+  std::vector<GatewayReactor *> reactors_;
+  std::unique_ptr<OrderBookV6> book_;
+  // Session that added each order id. Sessions live as long as their
+  // reactor, so a pointer is never reused.
+  LazyArray<Session *> owners_{MAX_ORDER_ID};
+  OrderId next_order_id_ = 1;
+  uint64_t processed_ = 0;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+  MpscQueue<MatcherCommand, QUEUE_SIZE> queue_;
+};
+
+// co_await ReadSome/WriteSome: one read(2)/write(2) on the session's
+// socket, suspending first if it would block. The result is the byte
+// count, or -errno: a session may resume on another thread than it
+// started on, so it mustn't look at errno itself across a co_await. After
+// a wake-up they try once more and may still give -EAGAIN (the edge was
+// for the other direction), so callers loop.
+struct SocketAwaitable {
+  Session &session;
+  char *data;
+  size_t size;
+  bool writing;
+  ssize_t result = 0;
+
+  ssize_t Transfer() {
+    ssize_t n = writing ? write(session.fd, data, size)
+                        : read(session.fd, data, size);
+    return n >= 0 ? n : -errno;
+  }
+  bool await_ready() {
+    result = Transfer();
+    return result != -EAGAIN;
+  }
+  void await_suspend(std::coroutine_handle<> handle) {
+    session.io_waiter = handle;
+  }
+  ssize_t await_resume() {
+    if (result == -EAGAIN) result = Transfer();
+    return result;
+  }
+};
+
+inline SocketAwaitable ReadSome(Session &session, void *data, size_t size) {
+  return {session, static_cast<char *>(data), size, false};
+}
+inline SocketAwaitable WriteSome(Session &session, const void *data,
+                                 size_t size) {
+  return {session, static_cast<char *>(const_cast<void *>(data)), size, true};
+}
+
+// co_await Submit: queues the request for the matcher and resumes, on the
+// reactor thread, once its ack is back.
+struct SubmitAwaitable {
+  GatewayMatcher &matcher;
+  Session &session;
+  const OrderRequest &request;
+
+  bool await_ready() { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    session.ack_waiter = handle;
+    matcher.Submit({&session, request});
+  }
+  const OrderAck &await_resume() { return session.ack; }
+};
+
+inline SubmitAwaitable Submit(GatewayMatcher &matcher, Session &session,
+                              const OrderRequest &request) {
+  return {matcher, session, request};
+}
+
+// One connection: read a request, check it, submit it, write the ack,
+// until the client disconnects.
+inline SessionTask RunSession(Session &session, GatewayMatcher &matcher,
+                              const RiskLimits &limits) {
+  OrderRequest request;
+  OrderAck ack;
+  for (;;) {
+    size_t got = 0;
+    while (got < sizeof request) {
+      ssize_t n = co_await ReadSome(
+          session, reinterpret_cast<char *>(&request) + got,
+          sizeof request - got);
+      if (n > 0) {
+        got += n;
+      } else if (n != -EAGAIN) {
+        session.reactor->Close(session);
+        co_return;
+      }
+    }
+
+    if (limits.Allows(request)) {
+      ack = co_await Submit(matcher, session, request);
+    } else {
+      ack = {request.client_tag, request.order_id, AckStatus::REJECTED};
+    }
+
+    size_t sent = 0;
+    while (sent < sizeof ack) {
+      ssize_t n = co_await WriteSome(
+          session, reinterpret_cast<char *>(&ack) + sent, sizeof ack - sent);
+      if (n > 0) {
+        sent += n;
+      } else if (n != -EAGAIN) {
+        session.reactor->Close(session);
+        co_return;
+      }
+    }
+  }
+}
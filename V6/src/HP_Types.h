@@ -7,7 +7,9 @@ using Price = uint32_t;
 using Quantity = uint32_t;
 using OrderId = uint64_t;
 
-// Define compile-time constants for array sizes
+// Define compile-time constants for array sizes. These are the default
+// book's shape (DefaultBookTraits, BookTraits.h); a book with other traits
+// takes its limits from them instead.
 constexpr Price MAX_PRICE = 25000;
 constexpr OrderId MAX_ORDER_ID = 3000000;
 
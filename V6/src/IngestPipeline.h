@@ -0,0 +1,120 @@
+#pragma once
+
+#include "MarketData.h"
+#include "Queues.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+// Parses a mapped market_data_*.csv on worker threads and hands the
+// messages to one consumer in file order.
+//
+// The file is cut into CHUNK_BYTES chunks at line starts (a line belongs to
+// the chunk its first byte is in, so any thread can find a chunk's bounds
+// on its own). Chunk c is parsed by worker c % threads into a batch, and
+// each worker has its own SPSC queue of full batches plus one of empty
+// batches coming back. Since a worker takes its chunks in order and the
+// consumer visits the workers round-robin, popping from queue c % threads
+// always yields chunk c: ordering needs no sequence numbers or reorder
+// buffer. Batches are recycled, so nothing is allocated once each has
+// grown to a chunk's worth of messages.
+class ParallelIngest {
+public:
+  static constexpr size_t CHUNK_BYTES = 256 << 10;
+  static constexpr size_t BATCHES_PER_WORKER = 8;
+
+  // Workers start at once. avoid_cpu >= 0 keeps them off that CPU (the
+  // matcher's) where the affinity mask allows.
+  ParallelIngest(const char *data, size_t size, unsigned threads,
+                 int avoid_cpu = -1)
+      : data_(data), size_(size),
+        chunks_((size + CHUNK_BYTES - 1) / CHUNK_BYTES),
+        workers_(threads ? threads : 1) {
+    for (Worker &worker : workers_) {
+      worker.batches.resize(BATCHES_PER_WORKER);
+      for (std::vector<Message> &batch : worker.batches) {
+        worker.free.TryPush(&batch);
+      }
+    }
+    for (unsigned w = 0; w < workers_.size(); ++w) {
+      workers_[w].thread = std::thread([this, w, avoid_cpu]() {
+        if (avoid_cpu >= 0) AvoidCpu(avoid_cpu);
+        Parse(w);
+      });
+    }
+  }
+
+  ~ParallelIngest() {
+    stop_.store(true, std::memory_order_relaxed);
+    for (Worker &worker : workers_) worker.thread.join();
+  }
+
+  // Calls apply(const Message &) for every line, in file order, on the
+  // calling thread. Returns the number of messages.
+  template <typename Apply> size_t Drain(Apply &&apply) {
+    size_t count = 0;
+    const size_t threads = workers_.size();
+    for (size_t chunk = 0; chunk < chunks_; ++chunk) {
+      Worker &worker = workers_[chunk % threads];
+      std::vector<Message> *batch;
+      for (Backoff backoff; !worker.full.TryPop(batch);) backoff.Wait();
+      for (const Message &msg : *batch) apply(msg);
+      count += batch->size();
+      worker.free.TryPush(batch); // can't fail: it holds every batch
+    }
+    return count;
+  }
+
+private:
+  using BatchQueue = SpscQueue<std::vector<Message> *, BATCHES_PER_WORKER>;
+
+  struct Worker {
+    BatchQueue full;
+    BatchQueue free;
+    std::vector<std::vector<Message>> batches;
+    std::thread thread;
+  };
+
+  // Offset of the first line starting at or after offset.
+  size_t LineStart(size_t offset) const {
+    if (offset == 0) return 0;
+    if (offset >= size_) return size_;
+    if (data_[offset - 1] == '\n') return offset;
+    const void *newline = std::memchr(data_ + offset, '\n', size_ - offset);
+    return newline ? static_cast<const char *>(newline) - data_ + 1 : size_;
+  }
+
+  void Parse(unsigned w) {
+    Worker &worker = workers_[w];
+    for (size_t chunk = w; chunk < chunks_; chunk += workers_.size()) {
+      std::vector<Message> *batch;
+      for (Backoff backoff; !worker.free.TryPop(batch);) {
+        if (stop_.load(std::memory_order_relaxed)) return;
+        backoff.Wait();
+      }
+      batch->clear();
+      size_t begin = LineStart(chunk * CHUNK_BYTES);
+      size_t end = LineStart((chunk + 1) * CHUNK_BYTES);
+      ParseMessages(data_ + begin, data_ + end, *batch);
+      worker.full.TryPush(batch); // can't fail: one slot per batch
+    }
+  }
+
+  static void AvoidCpu(int cpu) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return;
+    CPU_CLR(cpu, &set);
+    if (CPU_COUNT(&set) > 0) sched_setaffinity(0, sizeof(set), &set);
+  }
+
+  const char *data_;
+  size_t size_;
+  size_t chunks_;
+  std::vector<Worker> workers_;
+  std::atomic<bool> stop_{false};
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "HP_Types.h"
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// One parsed CSV line. The benchmark drivers load the whole file up front
+// so that the timed loop measures the book, not the parser.
+struct Message {
+  OrderId order_id;
+  Price price;
+  Quantity quantity;
+  char type; // 'A' add, 'C' cancel
+  Side side;
+};
+
+// Inlined fast integer parser
+inline uint64_t parse_int(const char *&ptr) {
+  uint64_t val = 0;
+  while (*ptr >= '0' && *ptr <= '9') {
+    val = val * 10 + (*ptr++ - '0');
+  }
+  return val;
+}
+
+// The price field of market_data_*.csv: an integer level.
+struct IntegerPrice {
+  Price operator()(const char *&ptr) const {
+    return static_cast<Price>(parse_int(ptr));
+  }
+};
+
+// Parses the CSV line at ptr into msg and leaves ptr at the start of the
+// next line. parse_price reads an add's price field, so files with another
+// price format (main_decimal_v6.cpp) share the rest of the parser.
+template <typename PriceField = IntegerPrice>
+inline void ParseMessage(const char *&ptr, const char *end, Message &msg,
+                         const PriceField &parse_price = PriceField()) {
+  msg = Message{};
+  msg.type = *ptr;
+  ptr += 2; // Skip type and comma
+  msg.side = (*ptr == 'B') ? Side::BUY : Side::SELL;
+  ptr += 2; // Skip side and comma
+  msg.order_id = parse_int(ptr);
+  if (msg.type == 'A') {
+    ptr++; // Skip comma
+    msg.price = parse_price(ptr);
+    ptr++; // Skip comma
+    msg.quantity = parse_int(ptr);
+  }
+
+  // Move to the next line
+  while (ptr < end && *ptr != '\n') {
+    ptr++;
+  }
+  if (ptr < end)
+    ptr++;
+}
+
+// Parses market_data_*.csv text with the same fast path as
+// main_fast_v6.cpp, appending one Message per line.
+inline void ParseMessages(const char *ptr, const char *end,
+                          std::vector<Message> &out) {
+  while (ptr < end) {
+    Message msg;
+    ParseMessage(ptr, end, msg);
+    out.push_back(msg);
+  }
+}
+
+// Maps a whole file read-only; release it with munmap. Returns false
+// (after perror) if the file can't be read.
+inline bool MapFile(const char *filename, const char *&buffer,
+                    size_t &file_size) {
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    perror("open");
+    return false;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) == -1) {
+    perror("fstat");
+    close(fd);
+    return false;
+  }
+  file_size = sb.st_size;
+
+  buffer = (const char *)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (buffer == MAP_FAILED) {
+    perror("mmap");
+    close(fd);
+    return false;
+  }
+  close(fd);
+  return true;
+}
+
+// Maps and parses a whole market_data_*.csv file. Returns false (after
+// perror) if the file can't be read.
+inline bool LoadMessages(const char *filename, std::vector<Message> &out) {
+  const char *buffer;
+  size_t file_size;
+  if (!MapFile(filename, buffer, file_size)) return false;
+  ParseMessages(buffer, buffer + file_size, out);
+  munmap((void *)buffer, file_size);
+  return true;
+}
+
+// The drivers' timing line, from start to now.
+inline void PrintProcessingTime(
+    std::chrono::high_resolution_clock::time_point start) {
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::high_resolution_clock::now() - start);
+  std::cout << "V6 Processing Time: " << duration.count() << " ms" << std::endl;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Level-matching policies for BasicOrderBookV6. A policy fills up to
+// `quantity` against one price level and returns what is left over. It
+// updates each order's quantity and level.total_quantity, reports every
+// fill to `on_trade(order, trade_quantity)`, and hands every order that
+// reaches zero to `on_filled`, which unlinks and frees it, so a policy must
+// read `next` before making that call. Quantities have the width of the
+// book's traits (Level::Quantity).
+
+// Price-time priority: walk the queue from the head.
+struct FifoMatch {
+  template <typename Level, typename OnTrade, typename OnFilled>
+  static typename Level::Quantity
+  MatchLevel(Level &level, typename Level::Quantity quantity,
+             OnTrade &&on_trade, OnFilled &&on_filled) {
+    using Quantity = typename Level::Quantity;
+    auto *current_order = level.head;
+    while (current_order && quantity > 0) {
+      Quantity trade_quantity = std::min(quantity, current_order->quantity);
+      on_trade(current_order, trade_quantity);
+      current_order->quantity -= trade_quantity;
+      quantity -= trade_quantity;
+      level.total_quantity -= trade_quantity;
+      if (current_order->quantity == 0) {
+        auto *next_order = current_order->next;
+        on_filled(current_order);
+        current_order = next_order;
+      }
+    }
+    return quantity;
+  }
+};
+
+// Pro-rata: every order on the level receives its share of the incoming
+// quantity in one pass. Each order is given the difference between the
+// floored cumulative allocations before and after it,
+//
+//   fill_i = floor(C_i * Q / T) - floor(C_{i-1} * Q / T)
+//
+// where C_i is the resting quantity up to and including order i. The fills
+// sum to exactly Q, each is within one lot of the exact share and never
+// exceeds the order, so no second pass is needed to hand out rounding
+// leftovers. An aggressor that takes the whole level skips the arithmetic.
+struct ProRataMatch {
+  template <typename Level, typename OnTrade, typename OnFilled>
+  static typename Level::Quantity
+  MatchLevel(Level &level, typename Level::Quantity quantity,
+             OnTrade &&on_trade, OnFilled &&on_filled) {
+    using Quantity = typename Level::Quantity;
+    const Quantity total = level.total_quantity;
+    if (quantity >= total) {
+      auto *current_order = level.head;
+      while (current_order) {
+        auto *next_order = current_order->next;
+        on_trade(current_order, current_order->quantity);
+        current_order->quantity = 0;
+        on_filled(current_order);
+        current_order = next_order;
+      }
+      level.total_quantity = 0;
+      return quantity - total;
+    }
+
+    uint64_t cumulative = 0;
+    uint64_t allocated = 0;
+    auto *current_order = level.head;
+    while (current_order) {
+      auto *next_order = current_order->next;
+      cumulative += current_order->quantity;
+      uint64_t target = cumulative * quantity / total;
+      Quantity trade_quantity = static_cast<Quantity>(target - allocated);
+      allocated = target;
+      on_trade(current_order, trade_quantity);
+      current_order->quantity -= trade_quantity;
+      if (current_order->quantity == 0) on_filled(current_order);
+      current_order = next_order;
+    }
+    level.total_quantity -= quantity;
+    return 0;
+  }
+};
+
+// FIFO + pro-rata: the first TopPercent of the incoming quantity is filled
+// in time priority, the rest is split pro-rata across what remains.
+template <unsigned TopPercent> struct FifoProRataMatch {
+  static_assert(TopPercent <= 100, "TopPercent is a percentage");
+
+  template <typename Level, typename OnTrade, typename OnFilled>
+  static typename Level::Quantity
+  MatchLevel(Level &level, typename Level::Quantity quantity,
+             OnTrade &&on_trade, OnFilled &&on_filled) {
+    using Quantity = typename Level::Quantity;
+    Quantity fifo_quantity =
+        static_cast<Quantity>(uint64_t(quantity) * TopPercent / 100);
+    Quantity rest = quantity - fifo_quantity;
+    fifo_quantity =
+        FifoMatch::MatchLevel(level, fifo_quantity, on_trade, on_filled);
+    if (level.head == nullptr) return fifo_quantity + rest;
+    return ProRataMatch::MatchLevel(level, fifo_quantity + rest, on_trade,
+                                    on_filled);
+  }
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "HP_Types.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Zero-filled array in its own anonymous mapping. The kernel backs a page
+// only when it is first written, so a large reservation costs address
+// space rather than resident memory until it is used (or prefaulted, or
+// locked by mlockall). T must be valid as all-zero bytes.
+template <typename T> class LazyArray {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "LazyArray elements start as zero bytes");
+
+public:
+  LazyArray() = default;
+  explicit LazyArray(size_t size) : size_(size) {
+    if (size == 0) return;
+    void *mapped = mmap(nullptr, Bytes(), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) throw std::bad_alloc();
+    data_ = static_cast<T *>(mapped);
+  }
+  ~LazyArray() {
+    if (data_) munmap(data_, Bytes());
+  }
+  LazyArray(LazyArray &&other) noexcept
+      : data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+  LazyArray &operator=(LazyArray &&other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+  LazyArray(const LazyArray &) = delete;
+  LazyArray &operator=(const LazyArray &) = delete;
+
+  T &operator[](size_t i) { return data_[i]; }
+  const T &operator[](size_t i) const { return data_[i]; }
+  T *data() { return data_; }
+  const T *data() const { return data_; }
+  size_t size() const { return size_; }
+  size_t Bytes() const { return size_ * sizeof(T); }
+
+  // Backs every page now, for callers that would rather pay the faults up
+  // front than in the first messages. Pages are written, not just read: a
+  // read would only map the shared zero page and the first store would
+  // still fault.
+  void Prefault() {
+    if (!data_) return;
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(data_, Bytes(), MADV_POPULATE_WRITE) == 0) return;
+#endif
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    volatile char *bytes = reinterpret_cast<volatile char *>(data_);
+    for (size_t offset = 0; offset < Bytes(); offset += page) {
+      bytes[offset] = bytes[offset];
+    }
+  }
+
+  // Existing entries keep their values (mremap moves the pages without
+  // touching them); the new ones are zero.
+  void Grow(size_t size) {
+    if (size <= size_) return;
+    if (!data_) {
+      *this = LazyArray(size);
+      return;
+    }
+    void *mapped = mremap(data_, Bytes(), size * sizeof(T), MREMAP_MAYMOVE);
+    if (mapped == MAP_FAILED) throw std::bad_alloc();
+    data_ = static_cast<T *>(mapped);
+    size_ = size;
+  }
+
+private:
+  T *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// One preallocated structure: what it reserved, and how much of that is
+// resident. Resident is counted in whole pages (mincore), so small
+// structures sharing pages with the heap are approximate.
+struct MemoryUse {
+  std::string name;
+  size_t reserved;
+  size_t touched;
+};
+
+inline size_t ResidentBytes(const void *data, size_t bytes) {
+  if (data == nullptr || bytes == 0) return 0;
+  const size_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = reinterpret_cast<uintptr_t>(data) & ~(page - 1);
+  uintptr_t end = reinterpret_cast<uintptr_t>(data) + bytes;
+  size_t pages = (end - begin + page - 1) / page;
+  std::vector<unsigned char> resident(pages);
+  if (mincore(reinterpret_cast<void *>(begin), end - begin, resident.data())) {
+    return 0;
+  }
+  size_t count = 0;
+  for (unsigned char flags : resident) count += flags & 1;
+  return std::min(count * page, bytes);
+}
+
+// What a replay needed at its peak (BasicOrderBookV6::Profile).
+struct BookProfile {
+  size_t peak_resting_orders;
+  OrderId max_order_id; // direct index only; 0 for the hashed index
+};
+
+// Startup sizes for the book's preallocated structures. The defaults are
+// the compile-time limits; FromProfile derives smaller ones from a replay.
+// The order counts are starting points rather than limits: the pool adds
+// chunks and the indexes grow if the live book outruns them, at the cost
+// of a stall at that moment. price_limit is the instrument's price range
+// and is fixed: the book takes prices below it and nothing checks them.
+struct BookSizing {
+  size_t resting_orders;  // order pool slots, and the hashed index's table
+  OrderId order_id_limit; // direct index: ids below this fit without growing
+  Price price_limit = MAX_PRICE; // levels per side; at most MAX_PRICE
+
+  static constexpr size_t MIN_ORDERS = 4096;
+
+  static BookSizing FromProfile(const BookProfile &profile,
+                                double headroom = 1.25) {
+    BookSizing sizing;
+    sizing.resting_orders = std::max<size_t>(
+        MIN_ORDERS, static_cast<size_t>(profile.peak_resting_orders * headroom));
+    sizing.order_id_limit = std::max<OrderId>(
+        MIN_ORDERS, static_cast<OrderId>(profile.max_order_id * headroom) + 1);
+    return sizing;
+  }
+};
+
+// Sizing files are `key=value` lines; `#` starts a comment.
+inline bool SaveSizing(const char *path, const BookSizing &sizing,
+                       const std::string &comment) {
+  FILE *file = std::fopen(path, "w");
+  if (!file) {
+    perror("fopen");
+    return false;
+  }
+  std::fprintf(file,
+               "# %s\nresting_orders=%zu\norder_id_limit=%llu\n"
+               "price_limit=%llu\n",
+               comment.c_str(), sizing.resting_orders,
+               (unsigned long long)sizing.order_id_limit,
+               (unsigned long long)sizing.price_limit);
+  return std::fclose(file) == 0;
+}
+
+inline bool LoadSizing(const char *path, BookSizing &sizing) {
+  FILE *file = std::fopen(path, "r");
+  if (!file) {
+    perror("fopen");
+    return false;
+  }
+  char line[256];
+  bool ok = true;
+  while (ok && std::fgets(line, sizeof line, file)) {
+    unsigned long long value;
+    if (line[0] == '#' || line[0] == '\n') continue;
+    if (std::sscanf(line, "resting_orders=%llu", &value) == 1) {
+      if (value < BookSizing::MIN_ORDERS) {
+        std::fprintf(stderr, "%s: resting_orders must be at least %zu\n",
+                     path, BookSizing::MIN_ORDERS);
+        ok = false;
+      }
+      sizing.resting_orders = value;
+    } else if (std::sscanf(line, "order_id_limit=%llu", &value) == 1) {
+      if (value < BookSizing::MIN_ORDERS) {
+        std::fprintf(stderr, "%s: order_id_limit must be at least %zu\n",
+                     path, BookSizing::MIN_ORDERS);
+        ok = false;
+      }
+      sizing.order_id_limit = value;
+    } else if (std::sscanf(line, "price_limit=%llu", &value) == 1) {
+      if (value < 2 || value > MAX_PRICE) {
+        std::fprintf(stderr, "%s: price_limit must be 2..%u\n", path,
+                     MAX_PRICE);
+        ok = false;
+      }
+      sizing.price_limit = static_cast<Price>(value);
+    } else {
+      std::fprintf(stderr, "%s: unknown sizing line: %s", path, line);
+      ok = false;
+    }
+  }
+  std::fclose(file);
+  return ok;
+}
@@ -1,36 +1,75 @@
 #pragma once
 
+#include "MemoryFootprint.h"
 #include <vector>
-#include <stdexcept>
 #include <cstring> // For memset
 
+// Fixed-size slots handed out from lazily touched chunks (LazyArray): a
+// slot's page is only backed once the slot is first used, so a pool
+// reserved for millions of orders costs what the busiest moment needed.
+// Fresh slots are taken in order, and only when the free list is empty.
+// HighWater() is the peak number of live objects since construction or
+// the last ResetHighWater(). When the last chunk is used up another as
+// large as the whole pool so far is added; existing slots never move.
 template<typename T>
 class ObjectPool {
 public:
-    explicit ObjectPool(size_t initial_size) {
-        pool_.resize(initial_size);
+    explicit ObjectPool(size_t initial_size) : capacity_(initial_size) {
+        chunks_.emplace_back(initial_size);
         free_list_.reserve(initial_size);
-        for (size_t i = 0; i < initial_size; ++i) {
-            free_list_.push_back(&pool_[i]);
-        }
     }
 
     T* NewOrder() {
-        if (free_list_.empty()) {
-            throw std::runtime_error("ObjectPool exhausted");
+        if (++live_ > high_water_) high_water_ = live_;
+        if (!free_list_.empty()) {
+            T* obj = free_list_.back();
+            free_list_.pop_back();
+            return obj;
+        }
+        if (next_in_chunk_ == chunks_.back().size()) {
+            chunks_.emplace_back(capacity_);
+            capacity_ += capacity_;
+            next_in_chunk_ = 0;
         }
-        T* obj = free_list_.back();
-        free_list_.pop_back();
-        return obj;
+        return &chunks_.back()[next_in_chunk_++];
     }
 
     void DeleteOrder(T* obj) {
         // Zero out memory to prevent stale data issues
         memset(obj, 0, sizeof(T));
         free_list_.push_back(obj);
+        live_--;
+    }
+
+    size_t HighWater() const { return high_water_; }
+    // Forgets peaks above what is live now, e.g. after a warm-up.
+    void ResetHighWater() { high_water_ = live_; }
+
+    // Backs every slot and the free list's reservation (LazyArray::Prefault).
+    void Prefault() {
+        for (LazyArray<T>& chunk : chunks_) chunk.Prefault();
+        free_list_.resize(free_list_.capacity());
+        free_list_.resize(0);
+    }
+
+    // The slots, then the free list.
+    void AppendMemoryUse(const char* name, std::vector<MemoryUse>& out) const {
+        MemoryUse slots{name, 0, 0};
+        for (const LazyArray<T>& chunk : chunks_) {
+            slots.reserved += chunk.Bytes();
+            slots.touched += ResidentBytes(chunk.data(), chunk.Bytes());
+        }
+        out.push_back(slots);
+        size_t free_bytes = free_list_.capacity() * sizeof(T*);
+        out.push_back({std::string(name) + " free list", free_bytes,
+                       ResidentBytes(free_list_.data(), free_bytes)});
     }
 
 private:
-    std::vector<T> pool_;
+    std::vector<LazyArray<T>> chunks_;
+    size_t capacity_;
+    size_t next_in_chunk_ = 0;
+    size_t live_ = 0;
+    size_t high_water_ = 0;
     std::vector<T*> free_list_;
 };
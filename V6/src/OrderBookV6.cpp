@@ -1,186 +1,728 @@
 #include "OrderBookV6.h"
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
-// GCC/Clang builtins for bit manipulation
-#if defined(__GNUC__) || defined(__clang__)
-#define BUILTIN_CLZLL __builtin_clzll
-#define BUILTIN_CTZLL __builtin_ctzll
-#else
-#error "Compiler not supported for bit manipulation builtins"
-#endif
-
-constexpr size_t BITMAP_SIZE = (MAX_PRICE / 64) + 1;
-
-OrderBookV6::OrderBookV6() 
-    : bids_(MAX_PRICE + 1), 
-      asks_(MAX_PRICE + 1),
-      order_pool_(MAX_ORDER_ID),
-      order_map_(MAX_ORDER_ID, nullptr),
-      best_bid_(0),
-      best_ask_(MAX_PRICE),
-      bids_bitmap_(BITMAP_SIZE, 0),
-      asks_bitmap_(BITMAP_SIZE, 0) {}
-
-inline void OrderBookV6::set_bit(Price p, std::vector<uint64_t>& bitmap) {
-    bitmap[p >> 6] |= (1ULL << (p & 63));
-}
-
-inline void OrderBookV6::clear_bit(Price p, std::vector<uint64_t>& bitmap) {
-    bitmap[p >> 6] &= ~(1ULL << (p & 63));
-}
-
-void OrderBookV6::AddOrder(OrderId order_id, Side side, Price price, Quantity quantity) {
-    if (side == Side::BUY) {
-        while (quantity > 0 && price >= best_ask_ && best_ask_ < MAX_PRICE) {
-            PriceLevel_V6& level = asks_[best_ask_];
-            if (level.head == nullptr) { UpdateBestAsk(); continue; }
-            HP_Order_V6* current_order = level.head;
-            while (current_order && quantity > 0) {
-                Quantity trade_quantity = std::min(quantity, current_order->quantity);
-                current_order->quantity -= trade_quantity;
-                quantity -= trade_quantity;
-                level.total_quantity -= trade_quantity;
-                if (current_order->quantity == 0) {
-                    HP_Order_V6* next_order = current_order->next;
-                    order_map_[current_order->order_id] = nullptr;
-                    RemoveFromList(current_order);
-                    order_pool_.DeleteOrder(current_order);
-                    current_order = next_order;
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::BasicOrderBookV6()
+    : BasicOrderBookV6(DefaultSizing()) {}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+const BookSizing& BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::CheckSizing(const BookSizing& sizing) {
+    if (sizing.price_limit > BookTraits::PRICE_LIMIT) {
+        throw std::invalid_argument("BookSizing: price_limit above the traits' PRICE_LIMIT");
+    }
+    if (sizing.order_id_limit > std::numeric_limits<OrderId>::max()) {
+        throw std::invalid_argument("BookSizing: order_id_limit wider than OrderId");
+    }
+    return sizing;
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::BasicOrderBookV6(const BookSizing& sizing)
+    : sizing_(CheckSizing(sizing)),
+      price_limit_(sizing.price_limit),
+      bids_(sizing.price_limit),
+      asks_(sizing.price_limit),
+      order_pool_(sizing.resting_orders),
+      order_index_(sizing),
+      last_trade_price_(0),
+      now_(0),
+      session_close_(UINT64_MAX),
+      fill_ring_(nullptr),
+      fill_symbol_(0),
+      fills_dropped_(0),
+      in_auction_(false),
+      auction_bid_depth_(sizing.price_limit + 1),
+      auction_ask_depth_(sizing.price_limit + 1),
+      depth_cache_enabled_(false),
+      lazy_cancels_(false),
+      state_hash_enabled_(false),
+      state_hash_(0) {}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+template <Side S>
+auto BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::SideOf() -> Book<S>& {
+    if constexpr (S == Side::BUY) return bids_;
+    else return asks_;
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+template <Side S>
+auto BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::SideOf() const -> const Book<S>& {
+    if constexpr (S == Side::BUY) return bids_;
+    else return asks_;
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::AddOrder(OrderId order_id, Side side, Price price, Quantity quantity) {
+    if (in_auction_) {
+        RestOrder(order_id, side, price, quantity);
+        return;
+    }
+    Price last_trade_price = last_trade_price_;
+    ProcessOrder(order_id, side, price, quantity, true);
+    if (stops_ && last_trade_price_ != last_trade_price) ReleaseStops();
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::AddOrder(OrderId order_id, Side side, Price price, Quantity quantity,
+                                            TimeInForce tif, Timestamp expire_time) {
+    if (tif == TimeInForce::GTC) {
+        AddOrder(order_id, side, price, quantity);
+        return;
+    }
+    if (tif == TimeInForce::DAY) expire_time = session_close_;
+    const bool rest = expire_time > now_;
+    if (in_auction_) {
+        if (rest) ArmTimer(RestOrder(order_id, side, price, quantity), expire_time);
+        return;
+    }
+    Price last_trade_price = last_trade_price_;
+    Order* rested = ProcessOrder(order_id, side, price, quantity, rest);
+    // Armed before any stops run, so a stop that fills it disarms it.
+    if (rested) ArmTimer(rested, expire_time);
+    if (stops_ && last_trade_price_ != last_trade_price) ReleaseStops();
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::ArmTimer(Order* order, Timestamp expire_time) {
+    if (!timers_) timers_ = std::make_unique<TimerWheel>(now_);
+    order->timer = timers_->Add(order, expire_time);
+}
+
+// Expired orders come out of the wheel earliest first and leave through
+// CancelResting, like a cancel; they never trade, so stops are unaffected.
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+size_t BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::AdvanceTime(Timestamp now) {
+    if (now <= now_) return 0;
+    now_ = now;
+    if (!timers_) return 0;
+    size_t expired = 0;
+    void* expired_order;
+    while (timers_->PopExpired(now, expired_order)) {
+        Order* order = static_cast<Order*>(expired_order);
+        order->timer = 0;
+        if (order->side == Side::BUY) CancelResting<Side::BUY>(order);
+        else CancelResting<Side::SELL>(order);
+        expired++;
+    }
+    return expired;
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+auto BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::ProcessOrder(OrderId order_id, Side side, Price price,
+                                                        Quantity quantity, bool rest) -> Order* {
+    if (side == Side::BUY) return ProcessOrder<Side::BUY>(order_id, price, quantity, rest);
+    return ProcessOrder<Side::SELL>(order_id, price, quantity, rest);
+}
+
+// Matches against the opposite side while it is crossed, then rests the
+// remainder on side S.
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+template <Side S>
+auto BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::ProcessOrder(OrderId order_id, Price price,
+                                                        Quantity quantity, bool rest) -> Order* {
+    constexpr Side OPPOSITE = SideTraits<S, BookTraits>::OPPOSITE;
+    Book<OPPOSITE>& contra = SideOf<OPPOSITE>();
+
+    auto on_trade = [this](Order* resting_order, Quantity trade_quantity) {
+        HashRemove(resting_order, trade_quantity);
+        PublishFill(resting_order->price, trade_quantity);
+    };
+    auto remove_filled = [this, &contra](Order* filled_order) {
+        DisarmTimer(filled_order);
+        if (filled_order->order_id != Order::TOMBSTONE_ID) order_index_.Erase(filled_order->order_id);
+        contra.RemoveFromList(filled_order);
+        order_pool_.DeleteOrder(filled_order);
+    };
+
+    while (quantity > 0 && contra.CrossedBy(price)) {
+        const Price level_price = contra.best;
+        Level& level = contra.levels[level_price];
+        // A sweep continues at the next level; with the hot window on, its
+        // head order can be pulled in while this one is being matched.
+        if (contra.hot_enabled) __builtin_prefetch(contra.hot.head[1]);
+        last_trade_price_ = level_price;
+        quantity = MatchPolicy::MatchLevel(level, quantity, on_trade, remove_filled);
+        OnLevelChanged<OPPOSITE>(level_price);
+        if (level.total_quantity == 0) clear_bit(level_price, contra.bitmap);
+        contra.LevelChanged(level_price);
+    }
+
+    if (quantity > 0 && rest) return RestOrder<S>(order_id, price, quantity);
+    return nullptr;
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+auto BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::RestOrder(OrderId order_id, Side side, Price price,
+                                                     Quantity quantity) -> Order* {
+    if (side == Side::BUY) return RestOrder<Side::BUY>(order_id, price, quantity);
+    return RestOrder<Side::SELL>(order_id, price, quantity);
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+template <Side S>
+auto BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::RestOrder(OrderId order_id, Price price, Quantity quantity) -> Order* {
+    Book<S>& book_side = SideOf<S>();
+    Order* new_order = order_pool_.NewOrder();
+    new_order->order_id = order_id;
+    new_order->quantity = quantity;
+    new_order->price = price;
+    new_order->side = S;
+    order_index_.Insert(order_id, new_order);
+    if (state_hash_enabled_) state_hash_ += OrderStateWeight(order_id, S, price) * quantity;
+
+    // A level holding only cancelled orders is empty as far as the bitmap
+    // and BBO are concerned.
+    bool is_new_level = (book_side.levels[price].total_quantity == 0);
+    book_side.AddToList(price, new_order);
+    if (is_new_level) set_bit(price, book_side.bitmap);
+    book_side.LevelChanged(price);
+    OnLevelChanged<S>(price);
+    return new_order;
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::CancelOrder(OrderId order_id) {
+    Order* order = order_index_.Find(order_id);
+    if (order == nullptr) {
+        if (stops_) stops_->Cancel(order_id);
+        return;
+    }
+
+    if (order->side == Side::BUY) CancelResting<Side::BUY>(order);
+    else CancelResting<Side::SELL>(order);
+}
+
+// Eager mode unlinks and frees the order. Lazy mode only zeroes it in place
+// and takes it out of the level's total: the node stays in the queue as a
+// tombstone until a match walks over it (every match policy frees orders
+// whose quantity is 0) or Compact() sweeps the level.
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+template <Side S>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::CancelResting(Order* order) {
+    Book<S>& book_side = SideOf<S>();
+    Price price = order->price;
+
+    DisarmTimer(order);
+    order_index_.Erase(order->order_id);
+    HashRemove(order, order->quantity);
+    if (lazy_cancels_) {
+        book_side.levels[price].total_quantity -= order->quantity;
+        order->quantity = 0;
+        order->order_id = Order::TOMBSTONE_ID;
+        set_bit(price, book_side.tombstones);
+    } else {
+        book_side.RemoveFromList(order);
+        order_pool_.DeleteOrder(order);
+    }
+    OnLevelChanged<S>(price);
+
+    if (book_side.levels[price].total_quantity == 0) clear_bit(price, book_side.bitmap);
+    book_side.LevelChanged(price);
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::EnableLazyCancels() {
+    lazy_cancels_ = true;
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+size_t BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::Compact() {
+    return CompactSide<Side::BUY>() + CompactSide<Side::SELL>();
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+template <Side S>
+size_t BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::CompactSide() {
+    Book<S>& book_side = SideOf<S>();
+    size_t removed = 0;
+    for (size_t index = 0; index < book_side.tombstones.size(); ++index) {
+        uint64_t chunk = book_side.tombstones[index];
+        book_side.tombstones[index] = 0;
+        while (chunk != 0) {
+            Price price = (index << 6) + BUILTIN_CTZLL(chunk);
+            chunk &= chunk - 1;
+            Order* order = book_side.levels[price].head;
+            while (order != nullptr) {
+                Order* next_order = order->next;
+                if (order->quantity == 0) {
+                    book_side.RemoveFromList(order);
+                    order_pool_.DeleteOrder(order);
+                    removed++;
                 }
+                order = next_order;
             }
-            if (level.head == nullptr) {
-                clear_bit(best_ask_, asks_bitmap_);
-                UpdateBestAsk();
-            }
+            // Only the head can have moved; the hot window tracks it.
+            book_side.LevelChanged(price);
         }
+    }
+    return removed;
+}
 
-        if (quantity > 0) {
-            bool is_new_level = (bids_[price].head == nullptr);
-            HP_Order_V6* new_order = order_pool_.NewOrder();
-            new_order->order_id = order_id;
-            new_order->quantity = quantity;
-            new_order->price = price;
-            new_order->side = Side::BUY;
-            AddToList(price, new_order);
-            order_map_[order_id] = new_order;
-            if (is_new_level) set_bit(price, bids_bitmap_);
-            if (price > best_bid_) best_bid_ = price;
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+bool BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::AddStopOrder(OrderId order_id, Side side, Price stop_price, Quantity quantity) {
+    Price limit_price = (side == Side::BUY) ? BookTraits::PRICE_LIMIT : 0;
+    return AddStop(order_id, side, stop_price, limit_price, quantity, true);
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+bool BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::AddStopLimitOrder(OrderId order_id, Side side, Price stop_price,
+                                                     Price limit_price, Quantity quantity) {
+    return AddStop(order_id, side, stop_price, limit_price, quantity, false);
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+bool BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::AddStop(OrderId order_id, Side side, Price stop_price,
+                                           Price limit_price, Quantity quantity, bool is_market) {
+    // No trade prints at 0 or at the limit, so a stop there would wait
+    // forever; they are also the StopBook's empty marks.
+    if (stop_price == 0 || stop_price >= price_limit_) return false;
+    // A stop that is already through the last trade goes straight in.
+    bool triggered = last_trade_price_ != 0 &&
+        (side == Side::BUY ? stop_price <= last_trade_price_ : stop_price >= last_trade_price_);
+    if (triggered && !in_auction_) {
+        Price last_trade_price = last_trade_price_;
+        ProcessOrder(order_id, side, limit_price, quantity, !is_market);
+        if (stops_ && last_trade_price_ != last_trade_price) ReleaseStops();
+        return true;
+    }
+    if (!stops_) stops_ = std::make_unique<StopBook>(sizing_);
+    stops_->Add(order_id, side, stop_price, limit_price, quantity, is_market);
+    return true;
+}
+
+// Every released stop can move the last price again, so keep popping until
+// nothing more is crossed. The stop book's bitmaps make each pop O(1)
+// regardless of how many stops are still pending.
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::ReleaseStops() {
+    StopOrder_V6 stop;
+    while (stops_->PopTriggered(last_trade_price_, stop)) {
+        ProcessOrder(stop.order_id, stop.side, stop.limit_price, stop.quantity, !stop.is_market);
+    }
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::BeginAuction() {
+    in_auction_ = true;
+}
+
+// Uncrossing happens in three passes over the crossed range [asks_.best,
+// bids_.best]. First the level quantities are gathered into two contiguous
+// arrays and turned into cumulative depth: bids as a suffix sum (demand at
+// or above each price), asks as a prefix sum (supply at or below it).
+// Second, the equilibrium is picked from those arrays with branch-free
+// reductions the compiler can vectorize: maximum executable volume, then
+// minimum surplus, then the lowest such price. Third, every fill is done in
+// a single walk from the top of each side at that one price.
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+AuctionResult BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::Uncross() {
+    in_auction_ = false;
+    if (!asks_.CrossedBy(bids_.best)) return {0, 0};
+
+    const Price low = asks_.best;
+    const size_t n = bids_.best - asks_.best + 1;
+    uint64_t* bid_depth = auction_bid_depth_.data();
+    uint64_t* ask_depth = auction_ask_depth_.data();
+
+    for (size_t i = 0; i < n; ++i) {
+        bid_depth[i] = bids_.levels[low + i].total_quantity;
+        ask_depth[i] = asks_.levels[low + i].total_quantity;
+    }
+    for (size_t i = 1; i < n; ++i) ask_depth[i] += ask_depth[i - 1];
+    for (size_t i = n - 1; i > 0; --i) bid_depth[i - 1] += bid_depth[i];
+
+    uint64_t best_volume = 0;
+    for (size_t i = 0; i < n; ++i) {
+        best_volume = std::max(best_volume, std::min(bid_depth[i], ask_depth[i]));
+    }
+    if (best_volume == 0) return {0, 0};
+
+    uint64_t best_surplus = UINT64_MAX;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t volume = std::min(bid_depth[i], ask_depth[i]);
+        uint64_t surplus = std::max(bid_depth[i], ask_depth[i]) - volume;
+        best_surplus = std::min(best_surplus, volume == best_volume ? surplus : UINT64_MAX);
+    }
+
+    size_t index = 0;
+    while (std::min(bid_depth[index], ask_depth[index]) != best_volume ||
+           std::max(bid_depth[index], ask_depth[index]) - best_volume != best_surplus) {
+        index++;
+    }
+    const Price price = low + index;
+
+    // Both sides stay marketable at `price` until best_volume is exhausted,
+    // so the walk only ever looks at bids_.best/asks_.best.
+    uint64_t remaining = best_volume;
+    while (remaining > 0) {
+        const Price bid_price = bids_.best;
+        const Price ask_price = asks_.best;
+        Level& bid_level = bids_.levels[bid_price];
+        Level& ask_level = asks_.levels[ask_price];
+        Order* bid = bid_level.head;
+        Order* ask = ask_level.head;
+
+        Quantity trade_quantity = std::min(bid->quantity, ask->quantity);
+        if (trade_quantity > remaining) trade_quantity = static_cast<Quantity>(remaining);
+        HashRemove(bid, trade_quantity);
+        HashRemove(ask, trade_quantity);
+        PublishFill(price, trade_quantity);
+        bid->quantity -= trade_quantity;
+        ask->quantity -= trade_quantity;
+        bid_level.total_quantity -= trade_quantity;
+        ask_level.total_quantity -= trade_quantity;
+        remaining -= trade_quantity;
+
+        if (bid->quantity == 0) {
+            DisarmTimer(bid);
+            if (bid->order_id != Order::TOMBSTONE_ID) order_index_.Erase(bid->order_id);
+            bids_.RemoveFromList(bid);
+            order_pool_.DeleteOrder(bid);
+            if (bid_level.total_quantity == 0) clear_bit(bid_price, bids_.bitmap);
         }
-    } else { // Side::SELL
-        while (quantity > 0 && price <= best_bid_ && best_bid_ > 0) {
-            PriceLevel_V6& level = bids_[best_bid_];
-            if (level.head == nullptr) { UpdateBestBid(); continue; }
-            HP_Order_V6* current_order = level.head;
-            while (current_order && quantity > 0) {
-                Quantity trade_quantity = std::min(quantity, current_order->quantity);
-                current_order->quantity -= trade_quantity;
-                quantity -= trade_quantity;
-                level.total_quantity -= trade_quantity;
-                if (current_order->quantity == 0) {
-                    HP_Order_V6* next_order = current_order->next;
-                    order_map_[current_order->order_id] = nullptr;
-                    RemoveFromList(current_order);
-                    order_pool_.DeleteOrder(current_order);
-                    current_order = next_order;
-                }
-            }
-            if (level.head == nullptr) {
-                clear_bit(best_bid_, bids_bitmap_);
-                UpdateBestBid();
-            }
+        if (ask->quantity == 0) {
+            DisarmTimer(ask);
+            if (ask->order_id != Order::TOMBSTONE_ID) order_index_.Erase(ask->order_id);
+            asks_.RemoveFromList(ask);
+            order_pool_.DeleteOrder(ask);
+            if (ask_level.total_quantity == 0) clear_bit(ask_price, asks_.bitmap);
         }
-        
-        if (quantity > 0) {
-            bool is_new_level = (asks_[price].head == nullptr);
-            HP_Order_V6* new_order = order_pool_.NewOrder();
-            new_order->order_id = order_id;
-            new_order->quantity = quantity;
-            new_order->price = price;
-            new_order->side = Side::SELL;
-            AddToList(price, new_order);
-            order_map_[order_id] = new_order;
-            if (is_new_level) set_bit(price, asks_bitmap_);
-            if (price < best_ask_) best_ask_ = price;
+        bids_.LevelChanged(bid_price);
+        asks_.LevelChanged(ask_price);
+    }
+
+    if (depth_cache_enabled_) RebuildDepthCache();
+
+    Price last_trade_price = last_trade_price_;
+    last_trade_price_ = price;
+    if (stops_ && last_trade_price_ != last_trade_price) ReleaseStops();
+    return {price, best_volume};
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+size_t BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::GetDepth(Side side, size_t n, DepthLevel* out) const {
+    Price limit = (side == Side::BUY) ? 0 : BookTraits::PRICE_LIMIT;
+    return GetDepthUntil(side, limit, out, n);
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+size_t BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::GetDepthUntil(Side side, Price limit, DepthLevel* out,
+                                                    size_t max_levels) const {
+    if (side == Side::BUY) return GetDepthUntil<Side::BUY>(limit, out, max_levels);
+    return GetDepthUntil<Side::SELL>(limit, out, max_levels);
+}
+
+// Shallow requests are copied out of the hot window. Otherwise this walks
+// one 64-level word at a time: take the best set bit, emit it, clear it in
+// the local copy, repeat; move to the next word when it runs dry.
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+template <Side S>
+size_t BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::GetDepthUntil(Price limit, DepthLevel* out,
+                                                    size_t max_levels) const {
+    using Traits = SideTraits<S, BookTraits>;
+    const Book<S>& book_side = SideOf<S>();
+    if (book_side.best == Traits::EMPTY) return 0;
+
+    size_t count = 0;
+    if (max_levels <= book_side.hot_count) {
+        const auto& hot = book_side.hot;
+        while (count < max_levels) {
+            Price price = hot.price[count];
+            if (Traits::Better(limit, price) || price == Traits::EMPTY) break;
+            out[count] = {price, hot.quantity[count]};
+            count++;
         }
+        return count;
     }
+
+    size_t index = book_side.best >> 6;
+    uint64_t chunk = book_side.bitmap[index] & Traits::MaskFrom(book_side.best);
+    while (count < max_levels) {
+        while (chunk == 0) {
+            if (!Traits::NextWord(index, book_side.bitmap.size())) return count;
+            chunk = book_side.bitmap[index];
+        }
+        unsigned bit = Traits::BestBit(chunk);
+        Price price = (index << 6) + bit;
+        if (Traits::Better(limit, price) || price == Traits::EMPTY) return count;
+        out[count++] = {price, book_side.levels[price].total_quantity};
+        chunk &= ~(1ULL << bit);
+    }
+    return count;
 }
 
-void OrderBookV6::CancelOrder(OrderId order_id) {
-    if (order_id >= order_map_.size()) return;
-    HP_Order_V6* order = order_map_[order_id];
-    if (order == nullptr) return;
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::EnableHotLevels() {
+    bids_.EnableHot();
+    asks_.EnableHot();
+}
 
-    Price price = order->price;
-    Side side = order->side;
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::EnableDepthCache() {
+    depth_cache_enabled_ = true;
+    RebuildDepthCache();
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::RebuildDepthCache() {
+    depth_cache_.bid_count = GetDepth(Side::BUY, DEPTH_CACHE_LEVELS, depth_cache_.bids);
+    depth_cache_.ask_count = GetDepth(Side::SELL, DEPTH_CACHE_LEVELS, depth_cache_.asks);
+}
 
-    RemoveFromList(order);
-    order_map_[order_id] = nullptr;
-    order_pool_.DeleteOrder(order);
+// The snapshot always holds the best min(K, levels on side) levels, so a
+// change strictly behind the K-th cached price can be ignored. Otherwise the
+// level is updated in place, inserted (pushing the K-th out), or removed
+// (pulling the next level past the window in with one bitmap scan).
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+template <Side S>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::UpdateDepthCache(Price price) {
+    using Traits = SideTraits<S, BookTraits>;
+    const Book<S>& book_side = SideOf<S>();
+    DepthLevel* levels = (S == Side::BUY) ? depth_cache_.bids : depth_cache_.asks;
+    size_t& count = (S == Side::BUY) ? depth_cache_.bid_count : depth_cache_.ask_count;
 
-    if (side == Side::BUY && bids_[price].head == nullptr) {
-        clear_bit(price, bids_bitmap_);
-        if (price == best_bid_) UpdateBestBid();
-    } else if (side == Side::SELL && asks_[price].head == nullptr) {
-        clear_bit(price, asks_bitmap_);
-        if (price == best_ask_) UpdateBestAsk();
+    if (count == DEPTH_CACHE_LEVELS && Traits::Better(levels[count - 1].price, price)) return;
+
+    Quantity quantity = book_side.levels[price].total_quantity;
+    size_t i = 0;
+    while (i < count && Traits::Better(levels[i].price, price)) i++;
+
+    if (i < count && levels[i].price == price) {
+        if (quantity > 0) {
+            levels[i].quantity = quantity;
+            return;
+        }
+        std::copy(levels + i + 1, levels + count, levels + i);
+        count--;
+        if (count == DEPTH_CACHE_LEVELS - 1) {
+            // Scan from whichever is further out: the new last entry, or the
+            // removed level itself if it was the last (its bit may still be set).
+            Price last = (i == count) ? price : levels[count - 1].price;
+            Price from = Traits::Behind(last);
+            Price next = (from == Traits::EMPTY) ? from : Traits::Scan(book_side.bitmap, from);
+            if (next != Traits::EMPTY) levels[count++] = {next, book_side.levels[next].total_quantity};
+        }
+        return;
     }
+
+    if (quantity == 0) return;
+    if (count < DEPTH_CACHE_LEVELS) count++;
+    std::copy_backward(levels + i, levels + count - 1, levels + count);
+    levels[i] = {price, quantity};
 }
 
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::WarmUp(Price price, size_t orders) {
+    constexpr Price SPREAD = 8;
+    constexpr size_t BATCH = 1024;
+    // A book too narrow for the synthetic prices or ids is left cold.
+    if (price_limit_ < 2 * SPREAD + 2 || order_index_.IdLimit() < BATCH) return;
+    price = std::clamp<Price>(price, SPREAD + 1, price_limit_ - SPREAD - 1);
+    Price last_trade_price = last_trade_price_;
+    const OrderId max_order_id = order_index_.MaxOrderId();
+    const OrderId top_id = order_index_.IdLimit() - 1;
+    // Synthetic trades are not fills anyone should see.
+    FillRing* fill_ring = std::exchange(fill_ring_, nullptr);
 
-void OrderBookV6::AddToList(Price price, HP_Order_V6* order) {
-    auto& level = (order->side == Side::BUY) ? bids_[price] : asks_[price];
-    if (level.head == nullptr) {
-        level.head = level.tail = order;
-    } else {
-        level.tail->next = order;
-        order->prev = level.tail;
-        level.tail = order;
+    for (size_t done = 0; done < orders; done += BATCH) {
+        size_t batch = std::min(BATCH, orders - done);
+        // Buys and sells over the same 2 * SPREAD + 1 prices, so about half
+        // of them trade against what is resting.
+        for (size_t i = 0; i < batch; ++i) {
+            Side side = (i & 1) ? Side::SELL : Side::BUY;
+            Price order_price = price - SPREAD + static_cast<Price>(i * 7 % (2 * SPREAD + 1));
+            ProcessOrder(top_id - i, side, order_price,
+                         static_cast<Quantity>(1 + i % 100), true);
+        }
+        for (size_t i = 0; i < batch; ++i) CancelOrder(top_id - i);
+        // The tombstones left by the cancels still hold pool slots and sit
+        // in the level lists; free them before the next batch rests there.
+        if (lazy_cancels_) Compact();
     }
-    level.total_quantity += order->quantity;
+    last_trade_price_ = last_trade_price;
+    fill_ring_ = fill_ring;
+    // Keep the synthetic orders out of Profile().
+    order_pool_.ResetHighWater();
+    order_index_.ResetMaxOrderId(max_order_id);
 }
 
-void OrderBookV6::RemoveFromList(HP_Order_V6* order) {
-    auto& level = (order->side == Side::BUY) ? bids_[order->price] : asks_[order->price];
-    if (order->prev) order->prev->next = order->next;
-    if (order->next) order->next->prev = order->prev;
-    if (level.head == order) level.head = order->next;
-    if (level.tail == order) level.tail = order->prev;
-    level.total_quantity -= order->quantity;
-    order->next = order->prev = nullptr;
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::Prefault() {
+    order_pool_.Prefault();
+    order_index_.Prefault();
+    bids_.levels.Prefault();
+    asks_.levels.Prefault();
+    auction_bid_depth_.Prefault();
+    auction_ask_depth_.Prefault();
+    if (stops_) stops_->Prefault();
 }
 
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+void BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::EnableStateHash() {
+    state_hash_ = ComputeSideHash<Side::BUY>() + ComputeSideHash<Side::SELL>();
+    state_hash_enabled_ = true;
+}
 
-void OrderBookV6::UpdateBestBid() {
-    size_t index = best_bid_ >> 6;
-    uint64_t chunk = bids_bitmap_[index];
-    uint64_t mask = (1ULL << (best_bid_ & 63)) - 1;
-    mask |= (1ULL << (best_bid_ & 63));
-    chunk &= mask;
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+uint64_t BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::StateHash() const {
+    if (!state_hash_enabled_) return ComputeStateHash();
+    return state_hash_ + LastTradeStateTerm(last_trade_price_);
+}
 
-    while (chunk == 0) {
-        if (index == 0) {
-            best_bid_ = 0;
-            return;
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+uint64_t BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::ComputeStateHash() const {
+    return ComputeSideHash<Side::BUY>() + ComputeSideHash<Side::SELL>() +
+           LastTradeStateTerm(last_trade_price_);
+}
+
+// Tombstones and levels that only hold tombstones add nothing, so only the
+// levels set in the bitmap are walked.
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+template <Side S>
+uint64_t BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::ComputeSideHash() const {
+    const Book<S>& book_side = SideOf<S>();
+    uint64_t hash = 0;
+    for (size_t index = 0; index < book_side.bitmap.size(); ++index) {
+        for (uint64_t chunk = book_side.bitmap[index]; chunk != 0; chunk &= chunk - 1) {
+            Price price = (index << 6) + BUILTIN_CTZLL(chunk);
+            for (const Order* order = book_side.levels[price].head; order; order = order->next) {
+                hash += OrderStateWeight(order->order_id, S, price) * order->quantity;
+            }
         }
-        index--;
-        chunk = bids_bitmap_[index];
     }
-    best_bid_ = (index << 6) + (63 - BUILTIN_CLZLL(chunk));
+    return hash;
 }
 
-void OrderBookV6::UpdateBestAsk() {
-    size_t index = best_ask_ >> 6;
-    uint64_t chunk = asks_bitmap_[index];
-    uint64_t mask = ~((1ULL << (best_ask_ & 63)) - 1);
-    chunk &= mask;
-    
-    while (chunk == 0) {
-        index++;
-        if (index >= BITMAP_SIZE) {
-            best_ask_ = MAX_PRICE;
-            return;
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+bool BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::VerifyInvariants(std::string* error) const {
+    if (!VerifySide<Side::BUY>(error) || !VerifySide<Side::SELL>(error)) return false;
+    if (!in_auction_ && bids_.best != SideTraits<Side::BUY, BookTraits>::EMPTY &&
+        asks_.best != SideTraits<Side::SELL, BookTraits>::EMPTY && bids_.best >= asks_.best) {
+        if (error) {
+            *error = "book crossed outside an auction: bid " + std::to_string(bids_.best) +
+                     " >= ask " + std::to_string(asks_.best);
         }
-        chunk = asks_bitmap_[index];
+        return false;
+    }
+    if (state_hash_enabled_ &&
+        state_hash_ != ComputeSideHash<Side::BUY>() + ComputeSideHash<Side::SELL>()) {
+        if (error) *error = "rolling state hash differs from the recomputed one";
+        return false;
     }
-    best_ask_ = (index << 6) + BUILTIN_CTZLL(chunk);
+    return true;
 }
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+template <Side S>
+bool BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::VerifySide(std::string* error) const {
+    using Traits = SideTraits<S, BookTraits>;
+    const Book<S>& book_side = SideOf<S>();
+    auto fail = [error](Price price, const char* what) {
+        if (error) {
+            *error = std::string(S == Side::BUY ? "bid" : "ask") + " level " +
+                     std::to_string(price) + ": " + what;
+        }
+        return false;
+    };
+    auto bit_set = [](const auto& bitmap, Price price) {
+        return (bitmap[price >> 6] >> (price & 63)) & 1;
+    };
+
+    Price best = Traits::EMPTY;
+    for (Price price = 0; price <= price_limit_; ++price) {
+        const Level& level = book_side.levels[price];
+        uint64_t total = 0;
+        const Order* prev = nullptr;
+        for (const Order* order = level.head; order; prev = order, order = order->next) {
+            if (order->prev != prev) return fail(price, "broken prev link");
+            if (order->price != price || order->side != S) return fail(price, "order on the wrong level");
+            if (order->quantity == 0) {
+                if (!lazy_cancels_) return fail(price, "zero-quantity order without lazy cancels");
+                if (!bit_set(book_side.tombstones, price)) return fail(price, "tombstone not marked for Compact");
+                continue;
+            }
+            if (order_index_.Find(order->order_id) != order) return fail(price, "order missing from the order index");
+            if (order->timer != 0 && !timers_->Holds(order->timer, order)) {
+                return fail(price, "order's timer belongs to another order");
+            }
+            total += order->quantity;
+        }
+        if (level.tail != prev) return fail(price, "tail is not the last order");
+        if (total != level.total_quantity) return fail(price, "total_quantity is not the sum of its orders");
+        if (bit_set(book_side.bitmap, price) != (total > 0)) return fail(price, "bitmap bit disagrees with total_quantity");
+        if (total > 0 && (best == Traits::EMPTY || Traits::Better(price, best))) best = price;
+    }
+    if (book_side.best != best) return fail(book_side.best, "best price is not the best non-empty level");
+
+    // Walk the levels best first, as the hot window and depth cache hold them.
+    Price next = best;
+    size_t depth_count = (S == Side::BUY) ? depth_cache_.bid_count : depth_cache_.ask_count;
+    const DepthLevel* depth = (S == Side::BUY) ? depth_cache_.bids : depth_cache_.asks;
+    if (book_side.hot_enabled && best != Traits::EMPTY && book_side.hot_count == 0) {
+        return fail(best, "hot window empty on a non-empty side");
+    }
+    for (size_t i = 0; i < std::max(HOT_LEVELS, DEPTH_CACHE_LEVELS); ++i) {
+        if (next != Traits::EMPTY) next = Traits::Scan(book_side.bitmap, next);
+        const bool exists = next != Traits::EMPTY;
+        if (book_side.hot_enabled && i < book_side.hot_count) {
+            if (!exists || book_side.hot.price[i] != next ||
+                book_side.hot.quantity[i] != book_side.levels[next].total_quantity ||
+                book_side.hot.head[i] != book_side.levels[next].head) {
+                return fail(book_side.hot.price[i], "hot window disagrees with the levels");
+            }
+        }
+        if (depth_cache_enabled_ && i < DEPTH_CACHE_LEVELS) {
+            if (exists != (i < depth_count) ||
+                (exists && (depth[i].price != next ||
+                            depth[i].quantity != book_side.levels[next].total_quantity))) {
+                return fail(exists ? next : best, "depth cache disagrees with the levels");
+            }
+        }
+        if (!exists) break;
+        next = Traits::Behind(next);
+    }
+    return true;
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+std::vector<MemoryUse> BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::MemoryReport() const {
+    std::vector<MemoryUse> report;
+    order_pool_.AppendMemoryUse("order pool", report);
+    order_index_.AppendMemoryUse(report);
+    auto add_array = [&](const char* name, const auto& array) {
+        report.push_back({name, array.Bytes(), ResidentBytes(array.data(), array.Bytes())});
+    };
+    add_array("bid levels", bids_.levels);
+    add_array("ask levels", asks_.levels);
+    size_t bitmap_bytes = 4 * bids_.bitmap.size() * sizeof(uint64_t);
+    report.push_back({"bitmaps", bitmap_bytes,
+                      ResidentBytes(bids_.bitmap.data(), bitmap_bytes / 4) +
+                          ResidentBytes(bids_.tombstones.data(), bitmap_bytes / 4) +
+                          ResidentBytes(asks_.bitmap.data(), bitmap_bytes / 4) +
+                          ResidentBytes(asks_.tombstones.data(), bitmap_bytes / 4)});
+    MemoryUse auction{"auction scratch", 0, 0};
+    for (const auto* depth : {&auction_bid_depth_, &auction_ask_depth_}) {
+        auction.reserved += depth->Bytes();
+        auction.touched += ResidentBytes(depth->data(), depth->Bytes());
+    }
+    report.push_back(auction);
+    if (stops_) stops_->AppendMemoryUse(report);
+    if (timers_) timers_->AppendMemoryUse(report);
+    return report;
+}
+
+template <typename MatchPolicy, template <typename> class OrderIndex, typename BookTraits>
+BookProfile BasicOrderBookV6<MatchPolicy, OrderIndex, BookTraits>::Profile() const {
+    return {order_pool_.HighWater(), order_index_.MaxOrderId()};
+}
+
+template class BasicOrderBookV6<FifoMatch>;
+template class BasicOrderBookV6<ProRataMatch>;
+template class BasicOrderBookV6<FifoProRataMatch<40>>;
+template class BasicOrderBookV6<FifoMatch, HashedOrderIndex>;
+template class BasicOrderBookV6<FifoMatch, DirectOrderIndex, SmallTickBookTraits>;
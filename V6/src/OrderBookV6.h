@@ -1,54 +1,301 @@
 #pragma once
 
+#include "BookSide.h"
+#include "BookTraits.h"
 // Use the same types as V4
 #include "HP_Types.h"
+#include "MatchPolicy.h"
+#include "MemoryFootprint.h"
 #include "ObjectPool.h"
+#include "OrderIndex.h"
+#include "StateHash.h"
+#include "StopBook.h"
+#include "TimerWheel.h"
+#include "TradeAnalytics.h"
+#include <memory>
+#include <string>
 #include <vector>
 
-// Re-use V4's order struct for simplicity
-// using HP_Order_V6 = HP_Order_V4;
-// using PriceLevel_V6 = PriceLevel_V4;
+struct AuctionResult {
+  Price price;     // 0 when the book was not crossed
+  uint64_t volume; // quantity executed at `price`
+};
 
-// V6 needs the V4-style struct that includes price/side for fast cancellation.
-struct HP_Order_V6 {
-  OrderId order_id;
-  Quantity quantity;
+struct DepthLevel {
   Price price;
-  Side side;
-  HP_Order_V6 *next = nullptr;
-  HP_Order_V6 *prev = nullptr;
+  Quantity quantity;
 };
 
-struct PriceLevel_V6 {
-  Quantity total_quantity = 0;
-  HP_Order_V6 *head = nullptr;
-  HP_Order_V6 *tail = nullptr;
+constexpr size_t DEPTH_CACHE_LEVELS = 10;
+
+// Best DEPTH_CACHE_LEVELS levels of each side, best first.
+struct DepthSnapshot {
+  DepthLevel bids[DEPTH_CACHE_LEVELS];
+  DepthLevel asks[DEPTH_CACHE_LEVELS];
+  size_t bid_count = 0;
+  size_t ask_count = 0;
 };
 
-class OrderBookV6 {
+// MatchPolicy decides how an aggressor is shared out across one price level
+// (see MatchPolicy.h), OrderIndex how order ids are looked up
+// (OrderIndex.h), and BookTraits the widths of Price, Quantity and OrderId,
+// the price range and id capacity of the default sizing, and whether the
+// price-indexed arrays live on the heap or inline (BookTraits.h). The book
+// instantiations are listed at the bottom of OrderBookV6.cpp.
+//
+// Each public entry point branches on Side once and then runs a
+// template<Side S> member, so the matching, resting and cancel paths for
+// either side are straight-line code over BookSide<S> and its traits.
+template <typename MatchPolicy,
+          template <typename> class OrderIndex = DirectOrderIndex,
+          typename BookTraits = DefaultBookTraits>
+class BasicOrderBookV6 {
 public:
-  OrderBookV6();
+  using Price = typename BookTraits::Price;
+  using Quantity = typename BookTraits::Quantity;
+  using OrderId = typename BookTraits::OrderId;
+
+  // The default sizes every preallocated structure for the traits'
+  // limits; a BookSizing (typically loaded from a profile, see Profile())
+  // starts them smaller, and its price_limit narrows the levels, bitmaps
+  // and auction scratch to an instrument's price range. Untouched heap
+  // pages cost no memory either way. A sizing whose price_limit is above
+  // the traits' PRICE_LIMIT, or whose order_id_limit does not fit OrderId,
+  // throws std::invalid_argument.
+  BasicOrderBookV6();
+  explicit BasicOrderBookV6(const BookSizing &sizing);
+  static BookSizing DefaultSizing() {
+    return {Index::CAPACITY, BookTraits::ORDER_ID_LIMIT,
+            BookTraits::PRICE_LIMIT};
+  }
+  // Orders must be priced below this.
+  Price PriceLimit() const { return price_limit_; }
   void AddOrder(OrderId order_id, Side side, Price price, Quantity quantity);
   void CancelOrder(OrderId order_id);
 
+  // Stop orders wait in a separate price-indexed book and are fed back
+  // through AddOrder once the last traded price reaches their stop price.
+  // A stop-market order never rests: whatever it cannot fill is dropped.
+  // Stop prices run from 1 to PriceLimit() - 1, the prices a trade can
+  // print at; anything else could never trigger, and is refused (false)
+  // without touching the book.
+  bool AddStopOrder(OrderId order_id, Side side, Price stop_price,
+                    Quantity quantity);
+  bool AddStopLimitOrder(OrderId order_id, Side side, Price stop_price,
+                         Price limit_price, Quantity quantity);
+
+  Price LastTradePrice() const { return last_trade_price_; }
+
+  // Time in force. Book time only moves when AdvanceTime is called, in the
+  // caller's timestamp unit. A DAY or GTD order matches like any other and
+  // its remainder rests until the session close or expire_time, when
+  // AdvanceTime removes it exactly as CancelOrder would; one whose expiry
+  // has already passed never rests. DAY orders take the close set when they
+  // arrive (never, until SetSessionClose is called). Expiry times live in a
+  // TimerWheel created on the first timed order, so GTC-only books pay one
+  // check per removed order and nothing on the add path.
+  void AddOrder(OrderId order_id, Side side, Price price, Quantity quantity,
+                TimeInForce tif, Timestamp expire_time = 0);
+  void SetSessionClose(Timestamp close) { session_close_ = close; }
+  // Returns the number of orders that expired.
+  size_t AdvanceTime(Timestamp now);
+  Timestamp Now() const { return now_; }
+
+  // Call auction: between BeginAuction and Uncross, orders rest without
+  // matching and the book may cross. Uncross executes everything that can
+  // trade at a single equilibrium price and returns to continuous trading.
+  void BeginAuction();
+  AuctionResult Uncross();
+  bool InAuction() const { return in_auction_; }
+
+  // Aggregated depth, best price first, written into a caller-provided
+  // buffer; both return the level count. Both walk the side's bitmap with
+  // clz/ctz, so only non-empty levels are visited, and with the hot window
+  // enabled, requests no deeper than the window are answered from that
+  // single cache line.
+  //
+  // GetDepth writes the best `n` levels.
+  size_t GetDepth(Side side, size_t n, DepthLevel *out) const;
+  // GetDepthUntil writes levels up to `limit` (bids at or above it, asks at
+  // or below it), at most max_levels of them.
+  size_t GetDepthUntil(Side side, Price limit, DepthLevel *out,
+                       size_t max_levels) const;
+
+  // Opt-in hot window: the best HOT_LEVELS levels of each side (price,
+  // quantity, head order) kept in one 64-byte line per side, so best-level
+  // changes shift that line instead of scanning the bitmap (BookSide.h).
+  void EnableHotLevels();
+
+  // Opt-in lazy cancels for cancel-heavy flow: CancelOrder only zeroes the
+  // order and its share of the level total, leaving a tombstone that the
+  // next match over that level frees. Compact() frees the remaining
+  // tombstones in one pass over the marked levels; call it when idle.
+  // Returns the number of orders freed.
+  void EnableLazyCancels();
+  size_t Compact();
+
+  // Opt-in top-of-book snapshot. Once enabled it is kept current on every
+  // change to a level inside the top DEPTH_CACHE_LEVELS, and changes deeper
+  // in the book don't touch it, so reading it costs nothing.
+  void EnableDepthCache();
+  const DepthSnapshot &TopOfBook() const { return depth_cache_; }
+
+  // Pre-trading warm-up: `orders` synthetic orders around `price` are
+  // matched, rested and cancelled, in batches whose ids are taken from the
+  // top of the id range and freed again, so the code, the pool's free list
+  // and the levels near the expected trading range are in cache and the
+  // TLB before the first real message. Call it on an empty book; it leaves
+  // the book as it found it, Profile() as if it had never run, and
+  // publishes nothing to the fill stream. It does nothing on a book whose
+  // PriceLimit() is under 18 or whose id range is under 1024.
+  void WarmUp(Price price, size_t orders);
+
+  // Backs every page of the preallocated structures (pool, order index,
+  // levels, auction scratch, and the stop book if there is one), so the
+  // first messages take no page faults. Costs their full reserved size in
+  // resident memory; see MemoryReport().
+  void Prefault();
+
+  // Opt-in rolling digest of the resting book (StateHash.h): enabling it
+  // computes the digest of the book as it stands, after which every rest,
+  // fill and cancel adjusts it with one multiply-add. Replicas and
+  // differential runs compare StateHash() after each message. Without
+  // EnableStateHash, StateHash() computes the digest from scratch.
+  void EnableStateHash();
+  uint64_t StateHash() const;
+
+  // Debug check of everything the fast paths take on trust, in one pass
+  // over every level and resting order. It checks the list links, each
+  // order's price, side and index entry, total_quantity against the orders,
+  // the bitmap against total_quantity, tombstone marks, the best prices,
+  // the hot window and depth cache, that the book isn't crossed outside an
+  // auction, and the rolling digest. Returns false and describes the first
+  // problem found in *error.
+  bool VerifyInvariants(std::string *error) const;
+
+  // Opt-in fill stream for TradeAnalytics: every fill is pushed into `ring`
+  // tagged with `symbol` and stamped with book time. Continuous matching
+  // publishes one fill per resting order taken, at that order's price;
+  // Uncross publishes one per bid/ask pair it crosses, at the uncross
+  // price. A full ring never stalls matching: the fill is dropped and
+  // counted instead. Size the ring for the consumer's worst lag.
+  void EnableFillStream(FillRing *ring, uint32_t symbol) {
+    fill_ring_ = ring;
+    fill_symbol_ = symbol;
+  }
+  uint64_t FillsDropped() const { return fills_dropped_; }
+
+  // Bytes reserved against bytes resident, per preallocated structure.
+  std::vector<MemoryUse> MemoryReport() const;
+  // High-water marks so far, for BookSizing::FromProfile.
+  BookProfile Profile() const;
+
 private:
-  void AddToList(Price price, HP_Order_V6 *order);
-  void RemoveFromList(HP_Order_V6 *order);
-  void UpdateBestBid();
-  void UpdateBestAsk();
+  static_assert(sizeof(Price) <= sizeof(::Price) &&
+                    sizeof(Quantity) <= sizeof(::Quantity) &&
+                    sizeof(OrderId) <= sizeof(::OrderId),
+                "stops, fills and depth carry the default widths");
+
+  using Order = BasicOrder_V6<BookTraits>;
+  using Level = BasicPriceLevel_V6<BookTraits>;
+  using Index = OrderIndex<BookTraits>;
+  template <Side S> using Book = BookSide<S, BookTraits>;
+  template <typename T, size_t N>
+  using Array = typename BookTraits::Storage::template Array<T, N>;
+
+  static const BookSizing &CheckSizing(const BookSizing &sizing);
+  template <Side S> Book<S> &SideOf();
+  template <Side S> const Book<S> &SideOf() const;
 
-  inline void set_bit(Price p, std::vector<uint64_t> &bitmap);
-  inline void clear_bit(Price p, std::vector<uint64_t> &bitmap);
+  // Both return the order if it rested, else nullptr.
+  Order *ProcessOrder(OrderId order_id, Side side, Price price,
+                      Quantity quantity, bool rest);
+  template <Side S>
+  Order *ProcessOrder(OrderId order_id, Price price, Quantity quantity,
+                      bool rest);
+  template <Side S>
+  Order *RestOrder(OrderId order_id, Price price, Quantity quantity);
+  Order *RestOrder(OrderId order_id, Side side, Price price,
+                   Quantity quantity);
+  template <Side S> void CancelResting(Order *order);
+  template <Side S> size_t CompactSide();
+  bool AddStop(OrderId order_id, Side side, Price stop_price, Price limit_price,
+               Quantity quantity, bool is_market);
+  void ReleaseStops();
+  void ArmTimer(Order *order, Timestamp expire_time);
+  // Every path that frees or tombstones a resting order calls this first.
+  inline void DisarmTimer(Order *order) {
+    if (order->timer != 0) {
+      timers_->Remove(order->timer);
+      order->timer = 0;
+    }
+  }
 
-  std::vector<PriceLevel_V6> bids_;
-  std::vector<PriceLevel_V6> asks_;
+  template <Side S>
+  size_t GetDepthUntil(Price limit, DepthLevel *out, size_t max_levels) const;
+  template <Side S> inline void OnLevelChanged(Price price) {
+    if (depth_cache_enabled_) UpdateDepthCache<S>(price);
+  }
+  template <Side S> void UpdateDepthCache(Price price);
+  void RebuildDepthCache();
 
-  ObjectPool<HP_Order_V6> order_pool_;
-  std::vector<HP_Order_V6 *> order_map_;
+  inline void HashRemove(const Order *order, Quantity quantity) {
+    if (state_hash_enabled_) {
+      state_hash_ -= OrderStateWeight(order->order_id, order->side,
+                                      order->price) * quantity;
+    }
+  }
+  inline void PublishFill(Price price, Quantity quantity) {
+    if (fill_ring_ && quantity != 0 &&
+        !fill_ring_->TryPush({now_, price, quantity, fill_symbol_})) {
+      fills_dropped_++;
+    }
+  }
+  uint64_t ComputeStateHash() const;
+  template <Side S> uint64_t ComputeSideHash() const;
+  template <Side S> bool VerifySide(std::string *error) const;
+  BookSizing sizing_; // kept for the stop book, created on the first stop
+  Price price_limit_;
+  Book<Side::BUY> bids_;
+  Book<Side::SELL> asks_;
 
-  Price best_bid_;
-  Price best_ask_;
+  ObjectPool<Order> order_pool_;
+  Index order_index_;
 
-  std::vector<uint64_t> bids_bitmap_;
-  std::vector<uint64_t> asks_bitmap_;
+  // 0 until the first trade, like bids_.best when the bid side is empty.
+  Price last_trade_price_;
+  // Created on the first stop so books that never see one stay lean.
+  std::unique_ptr<StopBook> stops_;
+
+  // Created on the first DAY/GTD order that rests.
+  std::unique_ptr<TimerWheel> timers_;
+  Timestamp now_;
+  Timestamp session_close_;
+
+  FillRing *fill_ring_;
+  uint32_t fill_symbol_;
+  uint64_t fills_dropped_;
+
+  bool in_auction_;
+  // Scratch for Uncross: cumulative depth per price, indexed from asks_.best.
+  Array<uint64_t, Book<Side::BUY>::LEVELS> auction_bid_depth_;
+  Array<uint64_t, Book<Side::BUY>::LEVELS> auction_ask_depth_;
+
+  bool depth_cache_enabled_;
+  DepthSnapshot depth_cache_;
+
+  bool lazy_cancels_;
+
+  bool state_hash_enabled_;
+  // Order terms only; StateHash() adds the last-trade term.
+  uint64_t state_hash_;
 };
+
+using OrderBookV6 = BasicOrderBookV6<FifoMatch>;
+using OrderBookV6ProRata = BasicOrderBookV6<ProRataMatch>;
+using OrderBookV6FifoProRata = BasicOrderBookV6<FifoProRataMatch<40>>;
+using OrderBookV6Hashed = BasicOrderBookV6<FifoMatch, HashedOrderIndex>;
+// 16-bit prices over 4096 ticks, 32-bit ids, every price-indexed array
+// inline; about 260 KB, so allocate it with new.
+using OrderBookV6SmallTick =
+    BasicOrderBookV6<FifoMatch, DirectOrderIndex, SmallTickBookTraits>;
@@ -0,0 +1,168 @@
+#include "OrderBookV6Ring.h"
+#include <algorithm>
+
+OrderBookV6Ring::OrderBookV6Ring()
+    : OrderBookV6Ring(DefaultSizing()) {}
+
+OrderBookV6Ring::OrderBookV6Ring(const BookSizing& sizing)
+    : price_limit_(sizing.price_limit),
+      bids_(sizing.price_limit),
+      asks_(sizing.price_limit),
+      order_map_(sizing.order_id_limit),
+      last_trade_price_(0) {}
+
+OrderBookV6Ring::~OrderBookV6Ring() {
+    FreeSlots<Side::BUY>();
+    FreeSlots<Side::SELL>();
+}
+
+// Only levels that ever held an order have a ring; reading the others
+// maps nothing new.
+template <Side S>
+void OrderBookV6Ring::FreeSlots() {
+    LazyArray<RingLevel>& levels = SideOf<S>().levels;
+    for (size_t price = 0; price < levels.size(); ++price) {
+        delete[] levels[price].slots;
+    }
+}
+
+template <Side S>
+RingSide<S>& OrderBookV6Ring::SideOf() {
+    if constexpr (S == Side::BUY) return bids_;
+    else return asks_;
+}
+
+void OrderBookV6Ring::AddOrder(OrderId order_id, Side side, Price price, Quantity quantity) {
+    if (side == Side::BUY) ProcessOrder<Side::BUY>(order_id, price, quantity);
+    else ProcessOrder<Side::SELL>(order_id, price, quantity);
+}
+
+template <Side S>
+void OrderBookV6Ring::ProcessOrder(OrderId order_id, Price price, Quantity quantity) {
+    constexpr Side OPPOSITE = SideTraits<S>::OPPOSITE;
+    RingSide<OPPOSITE>& contra = SideOf<OPPOSITE>();
+
+    while (quantity > 0 && contra.CrossedBy(price)) {
+        RingLevel& level = contra.levels[contra.best];
+        const uint32_t mask = level.capacity - 1;
+        last_trade_price_ = contra.best;
+
+        while (quantity > 0 && level.head != level.tail) {
+            RingSlot& slot = level.slots[level.head & mask];
+            if (slot.quantity == 0) {
+                level.head++;
+                level.holes--;
+                continue;
+            }
+            Quantity trade_quantity = std::min(quantity, slot.quantity);
+            slot.quantity -= trade_quantity;
+            quantity -= trade_quantity;
+            level.total_quantity -= trade_quantity;
+            if (slot.quantity == 0) {
+                order_map_[slot.order_id].live = false;
+                level.head++;
+            }
+        }
+
+        if (level.total_quantity == 0) {
+            // Whatever is left between head and tail is holes.
+            level.head = level.tail;
+            level.holes = 0;
+            clear_bit(contra.best, contra.bitmap);
+            contra.UpdateBest();
+        }
+    }
+
+    if (quantity > 0) RestOrder<S>(order_id, price, quantity);
+}
+
+template <Side S>
+void OrderBookV6Ring::RestOrder(OrderId order_id, Price price, Quantity quantity) {
+    RingSide<S>& book_side = SideOf<S>();
+    RingLevel& level = book_side.levels[price];
+    if (level.total_quantity == 0) {
+        set_bit(price, book_side.bitmap);
+        if (SideTraits<S>::Better(price, book_side.best)) book_side.best = price;
+    }
+
+    if (level.tail - level.head == level.capacity) {
+        if (level.holes > 0 && level.holes * 2 >= level.capacity) Compact(level);
+        else Grow(level);
+    }
+    const uint32_t mask = level.capacity - 1;
+    level.slots[level.tail & mask] = {order_id, quantity};
+    if (order_id >= order_map_.size()) {
+        order_map_.Grow(std::max<size_t>(order_map_.size() * 2, order_id + 1));
+    }
+    order_map_[order_id] = {price, level.tail, S, true};
+    level.tail++;
+    level.total_quantity += quantity;
+}
+
+void OrderBookV6Ring::CancelOrder(OrderId order_id) {
+    if (order_id >= order_map_.size()) return;
+    RingOrderRef& ref = order_map_[order_id];
+    if (!ref.live) return;
+
+    if (ref.side == Side::BUY) CancelResting<Side::BUY>(ref);
+    else CancelResting<Side::SELL>(ref);
+}
+
+template <Side S>
+void OrderBookV6Ring::CancelResting(RingOrderRef& ref) {
+    RingSide<S>& book_side = SideOf<S>();
+    RingLevel& level = book_side.levels[ref.price];
+    const uint32_t mask = level.capacity - 1;
+    RingSlot& slot = level.slots[ref.seq & mask];
+
+    level.total_quantity -= slot.quantity;
+    slot.quantity = 0;
+    ref.live = false;
+
+    if (level.total_quantity == 0) {
+        level.head = level.tail;
+        level.holes = 0;
+        clear_bit(ref.price, book_side.bitmap);
+        if (ref.price == book_side.best) book_side.UpdateBest();
+    } else if (ref.seq == level.head) {
+        // Pop this slot and any holes behind it; a live slot remains.
+        level.head++;
+        while (level.slots[level.head & mask].quantity == 0) {
+            level.head++;
+            level.holes--;
+        }
+    } else {
+        level.holes++;
+    }
+}
+
+// Doubles the ring. Each slot keeps its sequence number, so the order map
+// stays valid.
+void OrderBookV6Ring::Grow(RingLevel& level) {
+    uint32_t capacity = std::max(RING_INITIAL_CAPACITY, level.capacity * 2);
+    RingSlot* slots = new RingSlot[capacity];
+    const uint32_t old_mask = level.capacity - 1;
+    const uint32_t new_mask = capacity - 1;
+    for (uint32_t seq = level.head; seq != level.tail; ++seq) {
+        slots[seq & new_mask] = level.slots[seq & old_mask];
+    }
+    delete[] level.slots;
+    level.slots = slots;
+    level.capacity = capacity;
+}
+
+// Slides live slots down over the holes, in queue order, renumbering them
+// in the order map.
+void OrderBookV6Ring::Compact(RingLevel& level) {
+    const uint32_t mask = level.capacity - 1;
+    uint32_t write = level.head;
+    for (uint32_t seq = level.head; seq != level.tail; ++seq) {
+        RingSlot slot = level.slots[seq & mask];
+        if (slot.quantity == 0) continue;
+        level.slots[write & mask] = slot;
+        order_map_[slot.order_id].seq = write;
+        write++;
+    }
+    level.tail = write;
+    level.holes = 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "BookSide.h"
+#include "HP_Types.h"
+#include "MemoryFootprint.h"
+#include <vector>
+
+// One resting order in a ring-buffer level: only what FIFO matching reads.
+// A quantity of 0 marks a hole left behind by a cancel.
+struct RingSlot {
+  OrderId order_id;
+  Quantity quantity;
+};
+
+// A price level stored as a power-of-two ring of slots instead of a linked
+// list. head and tail are running sequence numbers and slot `seq` lives at
+// slots[seq & (capacity - 1)], so the ring can double in size without
+// renumbering anything and an order can be found again from (price, seq).
+// `holes` counts the cancelled slots between head and tail. All zero is an
+// empty level with no ring yet, so levels can live in a LazyArray; the
+// book owns `slots`.
+struct RingLevel {
+  Quantity total_quantity;
+  uint32_t head;
+  uint32_t tail;
+  uint32_t holes;
+  uint32_t capacity;
+  RingSlot *slots;
+};
+
+// Where a resting order lives; all zero is "not resting".
+struct RingOrderRef {
+  Price price;
+  uint32_t seq;
+  Side side;
+  bool live;
+};
+
+constexpr uint32_t RING_INITIAL_CAPACITY = 8;
+
+// BookSide's counterpart for ring levels: level array, bitmap and best
+// price, with the same SideTraits.
+template <Side S> struct RingSide {
+  using Traits = SideTraits<S>;
+
+  // Levels for prices [0, price_limit], as BookSide.
+  explicit RingSide(Price price_limit)
+      : levels(price_limit + 1), bitmap(BitmapWords(price_limit), 0),
+        best(Traits::EMPTY) {}
+
+  bool CrossedBy(Price price) const {
+    return best != Traits::EMPTY && !Traits::Better(price, best);
+  }
+
+  void UpdateBest() { best = Traits::Scan(bitmap, best); }
+
+  LazyArray<RingLevel> levels;
+  std::vector<uint64_t> bitmap;
+  Price best;
+};
+
+// V6 with array-backed level queues. Filling a level reads its slots
+// front to back from one contiguous buffer instead of chasing next
+// pointers through the pool. A cancel only zeroes its slot: holes are
+// skipped by matching, popped once they reach the head, and squeezed out
+// when a full ring is at least half holes (instead of growing it).
+//
+// Price-time matching only, with no stops, auctions or depth queries; it
+// exists to compare the two level layouts (bench_ring_v6). Sized like
+// OrderBookV6 by a BookSizing: price_limit bounds the levels, and the
+// order map starts at order_id_limit ids and grows past it, as
+// DirectOrderIndex does. resting_orders is unused, since the slots live in
+// the levels.
+class OrderBookV6Ring {
+public:
+  OrderBookV6Ring();
+  explicit OrderBookV6Ring(const BookSizing &sizing);
+  ~OrderBookV6Ring();
+  OrderBookV6Ring(const OrderBookV6Ring &) = delete;
+  OrderBookV6Ring &operator=(const OrderBookV6Ring &) = delete;
+  static BookSizing DefaultSizing() {
+    return {MAX_ORDER_ID, MAX_ORDER_ID, MAX_PRICE};
+  }
+  // Orders must be priced below this.
+  Price PriceLimit() const { return price_limit_; }
+  void AddOrder(OrderId order_id, Side side, Price price, Quantity quantity);
+  void CancelOrder(OrderId order_id);
+
+  Price LastTradePrice() const { return last_trade_price_; }
+
+private:
+  template <Side S> RingSide<S> &SideOf();
+
+  template <Side S>
+  void ProcessOrder(OrderId order_id, Price price, Quantity quantity);
+  template <Side S>
+  void RestOrder(OrderId order_id, Price price, Quantity quantity);
+  template <Side S> void CancelResting(RingOrderRef &ref);
+
+  void Grow(RingLevel &level);
+  void Compact(RingLevel &level);
+
+  template <Side S> void FreeSlots();
+
+  Price price_limit_;
+  RingSide<Side::BUY> bids_;
+  RingSide<Side::SELL> asks_;
+
+  LazyArray<RingOrderRef> order_map_;
+
+  Price last_trade_price_;
+};
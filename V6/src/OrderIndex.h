@@ -0,0 +1,168 @@
+#pragma once
+
+#include "BookSide.h"
+#include "HP_Types.h"
+#include "MemoryFootprint.h"
+#include <cstddef>
+#include <vector>
+
+// Order-id lookup for BasicOrderBookV6: maps the id an order arrived with to
+// its resting node. CAPACITY is the default number of orders that can rest
+// at once and sizes the book's pool; BookSizing can replace it. Each index
+// is a template over the book's traits, which fix the id and node types.
+
+// An array indexed by the id itself: one load per lookup, but sized for
+// every id the session will ever use (order_id_limit, the traits'
+// ORDER_ID_LIMIT by default), however few of them are live. Pages of ids
+// never used are never touched, and an id past the limit grows the array.
+template <typename BookTraits> class DirectOrderIndex {
+public:
+  using OrderId = typename BookTraits::OrderId;
+  using Order = BasicOrder_V6<BookTraits>;
+  static constexpr size_t CAPACITY = BookTraits::ORDER_ID_LIMIT;
+
+  explicit DirectOrderIndex(const BookSizing &sizing)
+      : map_(sizing.order_id_limit), max_order_id_(0) {}
+
+  Order *Find(OrderId order_id) const {
+    return order_id < map_.size() ? map_[order_id] : nullptr;
+  }
+  void Insert(OrderId order_id, Order *order) {
+    if (order_id >= map_.size()) {
+      map_.Grow(std::max<size_t>(map_.size() * 2, size_t(order_id) + 1));
+    }
+    if (order_id > max_order_id_) max_order_id_ = order_id;
+    map_[order_id] = order;
+  }
+  void Erase(OrderId order_id) { map_[order_id] = nullptr; }
+
+  // Ids below this need no growth (WarmUp borrows the ones at the top).
+  OrderId IdLimit() const { return static_cast<OrderId>(map_.size()); }
+  OrderId MaxOrderId() const { return max_order_id_; }
+  // Drops ids inserted since MaxOrderId() was `max_order_id` from the mark.
+  void ResetMaxOrderId(OrderId max_order_id) { max_order_id_ = max_order_id; }
+
+  void Prefault() { map_.Prefault(); }
+
+  void AppendMemoryUse(std::vector<MemoryUse> &out) const {
+    out.push_back({"order index", map_.Bytes(),
+                   ResidentBytes(map_.data(), map_.Bytes())});
+  }
+
+private:
+  LazyArray<Order *> map_;
+  OrderId max_order_id_;
+};
+
+constexpr unsigned LIVE_ORDER_BITS = 20;
+constexpr size_t MAX_LIVE_ORDERS = size_t(1) << LIVE_ORDER_BITS;
+
+// Id translation for sessions whose ids grow without bound. External ids
+// are hashed into an open-addressing table sized for MAX_LIVE_ORDERS live
+// orders, and what they map to is a dense internal handle: the order's slot
+// in the book's pool, which goes back on the free list (and is reused by
+// the next order) as soon as the order fills or is cancelled. Memory
+// follows the number of resting orders, not the number of ids seen, and
+// any id of the traits' width except ~0 is accepted.
+//
+// Linear probing with Fibonacci hashing at no more than 50% load: the
+// table starts at twice sizing.resting_orders (rounded up to a power of
+// two) and doubles if more than that many orders rest. Erase shifts the
+// rest of the probe run back instead of leaving tombstones, so probe
+// lengths don't creep up over a long session.
+template <typename BookTraits> class HashedOrderIndex {
+public:
+  using OrderId = typename BookTraits::OrderId;
+  using Order = BasicOrder_V6<BookTraits>;
+  static constexpr size_t CAPACITY = MAX_LIVE_ORDERS;
+
+  explicit HashedOrderIndex(const BookSizing &sizing) : size_(0) {
+    table_bits_ = 1;
+    while ((size_t(1) << table_bits_) < 2 * sizing.resting_orders) {
+      table_bits_++;
+    }
+    mask_ = (size_t(1) << table_bits_) - 1;
+    slots_.assign(mask_ + 1, Slot{EMPTY, nullptr});
+  }
+
+  Order *Find(OrderId order_id) const {
+    for (size_t i = Home(order_id);; i = (i + 1) & mask_) {
+      if (slots_[i].order_id == order_id) return slots_[i].order;
+      if (slots_[i].order_id == EMPTY) return nullptr;
+    }
+  }
+
+  void Insert(OrderId order_id, Order *order) {
+    size_t i = Home(order_id);
+    while (slots_[i].order_id != EMPTY && slots_[i].order_id != order_id) {
+      i = (i + 1) & mask_;
+    }
+    if (slots_[i].order_id == EMPTY && ++size_ * 2 > slots_.size()) {
+      Rehash();
+      Insert(order_id, order);
+      return;
+    }
+    slots_[i] = {order_id, order};
+  }
+
+  void Erase(OrderId order_id) {
+    size_t i = Home(order_id);
+    while (slots_[i].order_id != order_id) {
+      if (slots_[i].order_id == EMPTY) return;
+      i = (i + 1) & mask_;
+    }
+    // Pull back every later entry of the run whose home is not in (i, j].
+    for (size_t j = (i + 1) & mask_; slots_[j].order_id != EMPTY;
+         j = (j + 1) & mask_) {
+      size_t home = Home(slots_[j].order_id);
+      if (((j - home) & mask_) >= ((j - i) & mask_)) {
+        slots_[i] = slots_[j];
+        i = j;
+      }
+    }
+    slots_[i].order_id = EMPTY;
+    size_--;
+  }
+
+  // Any id but ~0 is accepted; WarmUp borrows the ones below this.
+  OrderId IdLimit() const { return BookTraits::ORDER_ID_LIMIT; }
+  OrderId MaxOrderId() const { return 0; }
+  void ResetMaxOrderId(OrderId) {}
+
+  // The table is written in full when it is built.
+  void Prefault() {}
+
+  void AppendMemoryUse(std::vector<MemoryUse> &out) const {
+    size_t bytes = slots_.capacity() * sizeof(Slot);
+    out.push_back({"order index", bytes, ResidentBytes(slots_.data(), bytes)});
+  }
+
+private:
+  static constexpr OrderId EMPTY = ~OrderId(0);
+
+  struct Slot {
+    OrderId order_id;
+    Order *order;
+  };
+
+  size_t Home(OrderId order_id) const {
+    return (order_id * 0x9E3779B97F4A7C15ULL) >> (64 - table_bits_);
+  }
+
+  void Rehash() {
+    std::vector<Slot> old;
+    old.swap(slots_);
+    table_bits_++;
+    mask_ = (size_t(1) << table_bits_) - 1;
+    slots_.assign(mask_ + 1, Slot{EMPTY, nullptr});
+    size_ = 0;
+    for (const Slot &slot : old) {
+      if (slot.order_id != EMPTY) Insert(slot.order_id, slot.order);
+    }
+  }
+
+  std::vector<Slot> slots_;
+  unsigned table_bits_;
+  size_t mask_;
+  size_t size_;
+};
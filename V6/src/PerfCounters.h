@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware counters for this process via perf_event_open, user space only.
+// Each event is opened on its own rather than as a group, so a machine (or
+// VM) that lacks one of them still reports the rest; events that can't be
+// opened read as invalid. If the kernel multiplexes them, values are scaled
+// by time enabled / time running as `perf stat` does.
+enum PerfEvent {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_L1D_MISSES,
+  PERF_LLC_MISSES,
+  PERF_BRANCH_MISSES,
+  PERF_DTLB_MISSES,
+  PERF_EVENT_COUNT
+};
+
+constexpr const char *PERF_EVENT_NAMES[PERF_EVENT_COUNT] = {
+    "cycles",     "instructions",  "l1d_misses",
+    "llc_misses", "branch_misses", "dtlb_misses"};
+
+struct PerfReading {
+  uint64_t value[PERF_EVENT_COUNT] = {};
+  bool valid[PERF_EVENT_COUNT] = {};
+};
+
+class PerfCounters {
+public:
+  PerfCounters() {
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event) {
+      fds_[event] = Open(static_cast<PerfEvent>(event));
+    }
+  }
+  ~PerfCounters() {
+    for (int fd : fds_) {
+      if (fd != -1) close(fd);
+    }
+  }
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  bool Available() const {
+    for (int fd : fds_) {
+      if (fd != -1) return true;
+    }
+    return false;
+  }
+
+  void Start() {
+    for (int fd : fds_) {
+      if (fd == -1) continue;
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  PerfReading Stop() {
+    PerfReading reading;
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event) {
+      int fd = fds_[event];
+      if (fd == -1) continue;
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      // value, time enabled, time running
+      uint64_t data[3];
+      if (read(fd, data, sizeof(data)) != sizeof(data)) continue;
+      reading.value[event] =
+          data[2] == 0 ? 0
+                       : static_cast<uint64_t>(static_cast<double>(data[0]) *
+                                               data[1] / data[2]);
+      reading.valid[event] = true;
+    }
+    return reading;
+  }
+
+private:
+  static int Open(PerfEvent event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    constexpr uint64_t READ_MISS = (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    switch (event) {
+    case PERF_CYCLES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case PERF_INSTRUCTIONS:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case PERF_L1D_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D | READ_MISS;
+      break;
+    case PERF_LLC_MISSES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case PERF_BRANCH_MISSES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    case PERF_DTLB_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | READ_MISS;
+      break;
+    default:
+      return -1;
+    }
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+  int fds_[PERF_EVENT_COUNT];
+};
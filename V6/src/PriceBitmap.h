@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// GCC/Clang builtins for bit manipulation
+#if defined(__GNUC__) || defined(__clang__)
+#define BUILTIN_CLZLL __builtin_clzll
+#define BUILTIN_CTZLL __builtin_ctzll
+#else
+#error "Compiler not supported for bit manipulation builtins"
+#endif
+
+// Words for prices [0, price_limit]. Each book side derives its
+// BITMAP_SIZE from its traits' range (BookSide.h).
+constexpr size_t BitmapWords(size_t price_limit) {
+  return (price_limit / 64) + 1;
+}
+
+// One bit per price level. Shared by the resting book and the stop book;
+// a bitmap is any array of uint64_t words (std::vector, LazyArray,
+// InlineArray) and a price any unsigned width.
+template <typename P, typename Bitmap>
+inline void set_bit(P p, Bitmap &bitmap) {
+  bitmap[p >> 6] |= (1ULL << (p & 63));
+}
+
+template <typename P, typename Bitmap>
+inline void clear_bit(P p, Bitmap &bitmap) {
+  bitmap[p >> 6] &= ~(1ULL << (p & 63));
+}
+
+// Highest set price <= from, or `none` if there is no such price.
+template <typename P, typename Bitmap>
+inline P scan_down(const Bitmap &bitmap, P from, P none) {
+  size_t index = from >> 6;
+  uint64_t chunk = bitmap[index];
+  uint64_t mask = (1ULL << (from & 63)) - 1;
+  mask |= (1ULL << (from & 63));
+  chunk &= mask;
+
+  while (chunk == 0) {
+    if (index == 0) return none;
+    index--;
+    chunk = bitmap[index];
+  }
+  return static_cast<P>((index << 6) + (63 - BUILTIN_CLZLL(chunk)));
+}
+
+// Lowest set price >= from, or `none` if there is no such price.
+template <typename P, typename Bitmap>
+inline P scan_up(const Bitmap &bitmap, P from, P none) {
+  size_t index = from >> 6;
+  uint64_t chunk = bitmap[index];
+  uint64_t mask = ~((1ULL << (from & 63)) - 1);
+  chunk &= mask;
+
+  while (chunk == 0) {
+    index++;
+    if (index >= bitmap.size()) return none;
+    chunk = bitmap[index];
+  }
+  return static_cast<P>((index << 6) + BUILTIN_CTZLL(chunk));
+}
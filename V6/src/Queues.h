@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+// Bounded single-producer/single-consumer ring. Head and tail live on
+// their own cache lines, and each side keeps a cached copy of the other's
+// index so it only reads the shared one when the ring looks full or empty.
+template <typename T, size_t SIZE> class SpscQueue {
+  static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+
+public:
+  bool TryPush(const T &value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == SIZE) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == SIZE) return false;
+    }
+    slots_[tail & (SIZE - 1)] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T &value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) return false;
+    }
+    value = slots_[head & (SIZE - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  alignas(64) std::atomic<size_t> head_{0};
+  size_t tail_cache_ = 0; // consumer's view of tail_
+  alignas(64) std::atomic<size_t> tail_{0};
+  size_t head_cache_ = 0; // producer's view of head_
+  alignas(64) T slots_[SIZE];
+};
+
+// Bounded multi-producer/single-consumer ring (Vyukov's bounded queue
+// with a single consumer). Each cell carries a sequence number: producers
+// claim a position with one CAS on tail_ and publish the cell by bumping
+// its sequence, so a slow producer never blocks another's cell, only the
+// consumer's progress past it.
+template <typename T, size_t SIZE> class MpscQueue {
+  static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+
+public:
+  MpscQueue() {
+    for (size_t i = 0; i < SIZE; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool TryPush(const T &value) {
+    size_t position = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells_[position & (SIZE - 1)];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t lag = intptr_t(sequence) - intptr_t(position);
+      if (lag == 0) {
+        if (tail_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          cell.value = value;
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (lag < 0) {
+        return false; // full
+      } else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool TryPop(T &value) {
+    Cell &cell = cells_[head_ & (SIZE - 1)];
+    if (cell.sequence.load(std::memory_order_acquire) != head_ + 1) {
+      return false;
+    }
+    value = cell.value;
+    cell.sequence.store(head_ + SIZE, std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) size_t head_ = 0; // consumer only
+  alignas(64) Cell cells_[SIZE];
+};
+
+// Spins briefly, then yields, so a waiting thread doesn't starve the one
+// it waits for when there are fewer cores than threads.
+class Backoff {
+public:
+  void Wait() {
+    if (++spins_ < 128) {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  unsigned spins_ = 0;
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "MarketData.h"
+#include "Queues.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <new>
+#include <sys/mman.h>
+
+// Hot-standby replication of a book's input. The primary numbers every
+// message (sequence 1, 2, ...) and copies it into a shared-memory ring.
+// The replica applies the messages, in sequence, to its own book and acks
+// the last one applied. A client's ack is released only once the replica
+// has confirmed that sequence, so every acked message exists in two
+// processes. Both books are deterministic in their input, so they end in
+// the same state; the replica publishes its StateHash() for each sequence
+// and the primary compares it with its own.
+//
+// The ring lives in a MAP_SHARED mapping created before fork(), so it
+// survives either process dying: a record fully published before a crash
+// is still read by the survivor. Each side stamps a heartbeat, and a
+// side that sees neither progress nor a heartbeat for the timeout treats
+// the other as lost. That is failure detection only, with no fencing: a
+// primary stalled for longer than the timeout would be failed over while
+// still running.
+inline int64_t ReplicationClockNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Publish stamps the primary's heartbeat every message, so it reads the
+// coarse clock: a few ns instead of ~20, on the same epoch as
+// ReplicationClockNs() (steady_clock is CLOCK_MONOTONIC) and at most a
+// tick behind it, which is far inside any useful timeout.
+inline int64_t ReplicationCoarseClockNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+struct ReplicationChannel {
+  static constexpr size_t CAPACITY = 1 << 16; // records in flight
+  static constexpr size_t ACK_BATCH = 64;      // most records per replica ack
+
+  // Written by the primary.
+  alignas(64) std::atomic<uint64_t> published{0}; // last sequence in the ring
+  std::atomic<int64_t> primary_heartbeat{0};
+  std::atomic<bool> primary_done{false};
+
+  // Written by the replica.
+  alignas(64) std::atomic<uint64_t> applied{0}; // the ack: last sequence applied
+  std::atomic<int64_t> replica_heartbeat{0};
+  std::atomic<uint64_t> final_hash{0}; // state hash after its last message
+
+  // Both by sequence % CAPACITY.
+  alignas(64) Message records[CAPACITY];
+  alignas(64) uint64_t replica_hash[CAPACITY];
+
+  // Shared anonymous mapping, inherited by children forked afterwards.
+  static ReplicationChannel *Create() {
+    void *mapped = mmap(nullptr, sizeof(ReplicationChannel),
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1,
+                        0);
+    if (mapped == MAP_FAILED) {
+      perror("mmap");
+      return nullptr;
+    }
+    auto *channel = new (mapped) ReplicationChannel();
+    int64_t now = ReplicationClockNs();
+    channel->primary_heartbeat.store(now, std::memory_order_relaxed);
+    channel->replica_heartbeat.store(now, std::memory_order_relaxed);
+    return channel;
+  }
+
+  static void Destroy(ReplicationChannel *channel) {
+    channel->~ReplicationChannel();
+    munmap(channel, sizeof(ReplicationChannel));
+  }
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the ring's atomics must work across processes");
+
+class ReplicationPrimary {
+public:
+  ReplicationPrimary(ReplicationChannel &channel, int64_t timeout_ns)
+      : channel_(channel), timeout_ns_(timeout_ns) {
+    channel_.primary_heartbeat.store(ReplicationClockNs(),
+                                     std::memory_order_relaxed);
+  }
+
+  // Copies msg into the ring as the next sequence and returns it. Waits
+  // while the ring is full; returns 0 if the replica is lost meanwhile.
+  uint64_t Publish(const Message &msg) {
+    uint64_t sequence = sequence_ + 1;
+    if (sequence - acked_ > ReplicationChannel::CAPACITY) {
+      Backoff backoff;
+      while (sequence - Acked() > ReplicationChannel::CAPACITY) {
+        if (!Wait(backoff)) return 0;
+      }
+    }
+    channel_.records[sequence & (ReplicationChannel::CAPACITY - 1)] = msg;
+    channel_.published.store(sequence, std::memory_order_release);
+    sequence_ = sequence;
+    Beat();
+    return sequence;
+  }
+
+  // Last sequence the replica has applied: client acks up to here can be
+  // released.
+  uint64_t Acked() {
+    acked_ = channel_.applied.load(std::memory_order_acquire);
+    return acked_;
+  }
+
+  // Waits until the replica has applied `sequence`. False if it is lost.
+  bool WaitForAck(uint64_t sequence) {
+    Backoff backoff;
+    while (Acked() < sequence) {
+      if (!Wait(backoff)) return false;
+    }
+    return true;
+  }
+
+  // The replica's state hash after `sequence`, which must be acked and
+  // still within the last CAPACITY sequences.
+  uint64_t ReplicaHash(uint64_t sequence) const {
+    return channel_
+        .replica_hash[sequence & (ReplicationChannel::CAPACITY - 1)];
+  }
+
+  // Tells the replica the stream is over, and waits for its last ack.
+  bool Finish() {
+    channel_.primary_done.store(true, std::memory_order_release);
+    return WaitForAck(sequence_);
+  }
+
+  uint64_t Sequence() const { return sequence_; }
+
+  // Stamps the heartbeat. Publish and the waits stamp it themselves; a
+  // primary with nothing to publish must call this more often than the
+  // timeout, or the replica takes it for lost.
+  void Beat() {
+    channel_.primary_heartbeat.store(ReplicationCoarseClockNs(),
+                                     std::memory_order_relaxed);
+  }
+
+private:
+
+  // One backoff step while waiting on the replica.
+  bool Wait(Backoff &backoff) {
+    backoff.Wait();
+    int64_t now = ReplicationClockNs();
+    channel_.primary_heartbeat.store(now, std::memory_order_relaxed);
+    return now - channel_.replica_heartbeat.load(std::memory_order_relaxed) <
+           timeout_ns_;
+  }
+
+  ReplicationChannel &channel_;
+  int64_t timeout_ns_;
+  uint64_t sequence_ = 0;
+  uint64_t acked_ = 0; // cached channel_.applied
+};
+
+enum class FollowResult { PRIMARY_DONE, PRIMARY_LOST };
+
+// Replica loop: applies every published record to book (which must have
+// EnableStateHash() on), in sequence, acking after every ACK_BATCH, until the
+// primary finishes or is lost. apply(book, msg) applies one message. The
+// heartbeat is stamped once per batch, and while idle.
+template <typename Book, typename Apply>
+FollowResult FollowPrimary(ReplicationChannel &channel, Book &book,
+                           int64_t timeout_ns, Apply &&apply) {
+  uint64_t applied = channel.applied.load(std::memory_order_relaxed);
+  Backoff backoff;
+  int64_t idle_since = 0;
+  for (;;) {
+    uint64_t published = channel.published.load(std::memory_order_acquire);
+    if (published == applied) {
+      int64_t now = ReplicationClockNs();
+      channel.replica_heartbeat.store(now, std::memory_order_relaxed);
+      if (channel.primary_done.load(std::memory_order_acquire) &&
+          channel.published.load(std::memory_order_acquire) == applied) {
+        return FollowResult::PRIMARY_DONE;
+      }
+      if (idle_since == 0) idle_since = now;
+      if (now - idle_since > timeout_ns &&
+          now - channel.primary_heartbeat.load(std::memory_order_relaxed) >
+              timeout_ns) {
+        return FollowResult::PRIMARY_LOST;
+      }
+      backoff.Wait();
+      continue;
+    }
+    idle_since = 0;
+    backoff = Backoff();
+    uint64_t batch_end = std::min<uint64_t>(
+        published, applied + ReplicationChannel::ACK_BATCH);
+    while (applied < batch_end) {
+      ++applied;
+      const size_t slot = applied & (ReplicationChannel::CAPACITY - 1);
+      apply(book, channel.records[slot]);
+      channel.replica_hash[slot] = book.StateHash();
+    }
+    channel.final_hash.store(book.StateHash(), std::memory_order_relaxed);
+    channel.applied.store(applied, std::memory_order_release);
+    channel.replica_heartbeat.store(ReplicationClockNs(),
+                                    std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+// Where and how the matcher runs. Everything is off by default, which is
+// the old behaviour: threads go wherever the scheduler puts them and pages
+// are faulted in on first touch.
+struct RuntimeConfig {
+  int matcher_cpu = -1; // -1: not pinned
+  int io_cpu = -1;      // -1: input is loaded on the matcher thread
+  bool lock_memory = false;
+  bool prefault = false; // the input mapping and the book (Prefault())
+  size_t warmup_orders = 0;
+  int realtime_priority = 0; // SCHED_FIFO priority; 0 keeps SCHED_OTHER
+};
+
+// CPUs named in /sys/devices/system/cpu/isolated (isolcpus=), e.g. "2-3,6".
+inline std::vector<int> IsolatedCpus() {
+  std::vector<int> cpus;
+  std::ifstream file("/sys/devices/system/cpu/isolated");
+  std::string list;
+  if (!std::getline(file, list)) return cpus;
+  const char *ptr = list.c_str();
+  while (*ptr >= '0' && *ptr <= '9') {
+    char *next;
+    int first = static_cast<int>(std::strtol(ptr, &next, 10));
+    int last = first;
+    if (*next == '-') last = static_cast<int>(std::strtol(next + 1, &next, 10));
+    for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    ptr = *next == ',' ? next + 1 : next;
+  }
+  return cpus;
+}
+
+// The CPU `--cpu auto` means: the first isolated CPU we may run on, else the
+// highest-numbered CPU in our affinity mask (CPU 0 takes most interrupts).
+inline int PickMatcherCpu() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return -1;
+  for (int cpu : IsolatedCpus()) {
+    if (CPU_ISSET(cpu, &allowed)) return cpu;
+  }
+  for (int cpu = CPU_SETSIZE - 1; cpu >= 0; --cpu) {
+    if (CPU_ISSET(cpu, &allowed)) return cpu;
+  }
+  return -1;
+}
+
+inline bool IsIsolated(int cpu) {
+  for (int isolated : IsolatedCpus()) {
+    if (isolated == cpu) return true;
+  }
+  return false;
+}
+
+inline bool PinThread(pthread_t thread, int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+  if (err != 0) {
+    std::fprintf(stderr, "pin to cpu %d: %s\n", cpu, std::strerror(err));
+    return false;
+  }
+  return true;
+}
+
+// Locks everything mapped now and later, so nothing the matcher touches
+// can be paged out or faulted in lazily.
+inline bool LockMemory() {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    std::perror("mlockall");
+    return false;
+  }
+  return true;
+}
+
+inline bool SetRealtimePriority(int priority) {
+  sched_param param{};
+  param.sched_priority = priority;
+  if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+    std::perror("sched_setscheduler(SCHED_FIFO)");
+    return false;
+  }
+  return true;
+}
+
+// Faults in every page of a read-only mapping ahead of time.
+inline void PrefaultRead(const void *data, size_t size) {
+  madvise(const_cast<void *>(data), size, MADV_WILLNEED);
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const volatile char *bytes = static_cast<const volatile char *>(data);
+  for (size_t offset = 0; offset < size; offset += page) (void)bytes[offset];
+}
+
+// Consumes the runtime option at argv[i] (and its value), returning false
+// if argv[i] isn't one:
+//   --cpu N|auto  --io-cpu N  --mlock  --prefault  --warmup N  --rt PRIO
+inline bool ParseRuntimeOption(int argc, char *argv[], int &i,
+                               RuntimeConfig &config) {
+  const char *arg = argv[i];
+  auto value = [&]() -> const char * {
+    return i + 1 < argc ? argv[++i] : "";
+  };
+  if (std::strcmp(arg, "--cpu") == 0) {
+    const char *cpu = value();
+    config.matcher_cpu =
+        std::strcmp(cpu, "auto") == 0 ? PickMatcherCpu() : std::atoi(cpu);
+  } else if (std::strcmp(arg, "--io-cpu") == 0) {
+    config.io_cpu = std::atoi(value());
+  } else if (std::strcmp(arg, "--mlock") == 0) {
+    config.lock_memory = true;
+  } else if (std::strcmp(arg, "--prefault") == 0) {
+    config.prefault = true;
+  } else if (std::strcmp(arg, "--warmup") == 0) {
+    config.warmup_orders = std::strtoull(value(), nullptr, 10);
+  } else if (std::strcmp(arg, "--rt") == 0) {
+    config.realtime_priority = std::atoi(value());
+  } else {
+    return false;
+  }
+  return true;
+}
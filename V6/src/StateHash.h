@@ -0,0 +1,38 @@
+#pragma once
+
+#include "HP_Types.h"
+#include <cstdint>
+
+// 64-bit digest of a book's resting state, kept up to date in O(1) per
+// change (BasicOrderBookV6::EnableStateHash). It is the sum, mod 2^64, of
+//
+//   OrderStateWeight(id, side, price) * remaining quantity
+//
+// over every resting order, plus a term for the last trade price. Being a
+// sum of per-order terms, it doesn't depend on the order in which a state
+// was reached: resting adds a term, every fill or cancel subtracts weight
+// times the quantity removed, and an order at quantity 0 (filled, or a lazy
+// tombstone) contributes nothing. Two books that saw the same messages
+// have the same digest; a fill of the wrong order, a lost cancel or a
+// wrong remaining quantity changes it. Queue position within a level and
+// pending stop orders are not covered.
+
+// splitmix64's finaliser: every input bit affects every output bit.
+inline uint64_t MixStateBits(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+inline uint64_t OrderStateWeight(OrderId order_id, Side side, Price price) {
+  uint64_t key = MixStateBits(order_id) ^
+                 (uint64_t(price) << 1 | (side == Side::SELL ? 1 : 0));
+  return MixStateBits(key + 0x9E3779B97F4A7C15ULL);
+}
+
+inline uint64_t LastTradeStateTerm(Price last_trade_price) {
+  return MixStateBits(uint64_t(last_trade_price) ^ 0xD6E8FEB86659FD93ULL);
+}
@@ -0,0 +1,155 @@
+#include "StopBook.h"
+#include "PriceBitmap.h"
+
+StopBook::StopBook(const BookSizing& sizing)
+    : buy_stops_(sizing.price_limit + 1),
+      sell_stops_(sizing.price_limit + 1),
+      stop_pool_(sizing.resting_orders),
+      stop_map_(sizing.order_id_limit),
+      price_limit_(sizing.price_limit),
+      lowest_buy_stop_(sizing.price_limit),
+      highest_sell_stop_(0),
+      pending_(0),
+      buy_stops_bitmap_(BitmapWords(sizing.price_limit), 0),
+      sell_stops_bitmap_(BitmapWords(sizing.price_limit), 0) {}
+
+void StopBook::Add(OrderId order_id, Side side, Price stop_price, Price limit_price,
+                   Quantity quantity, bool is_market) {
+    StopOrder_V6* stop = stop_pool_.NewOrder();
+    stop->order_id = order_id;
+    stop->quantity = quantity;
+    stop->stop_price = stop_price;
+    stop->limit_price = limit_price;
+    stop->side = side;
+    stop->is_market = is_market;
+    if (order_id < stop_map_.size()) {
+        stop_map_[order_id] = stop;
+    } else {
+        stop_overflow_[order_id] = stop;
+    }
+    pending_++;
+
+    if (side == Side::BUY) {
+        AddToList(buy_stops_[stop_price], stop);
+        set_bit(stop_price, buy_stops_bitmap_);
+        if (stop_price < lowest_buy_stop_) lowest_buy_stop_ = stop_price;
+    } else {
+        AddToList(sell_stops_[stop_price], stop);
+        set_bit(stop_price, sell_stops_bitmap_);
+        if (stop_price > highest_sell_stop_) highest_sell_stop_ = stop_price;
+    }
+}
+
+bool StopBook::Cancel(OrderId order_id) {
+    StopOrder_V6* stop = Find(order_id);
+    if (stop == nullptr) return false;
+
+    Price price = stop->stop_price;
+    if (stop->side == Side::BUY) {
+        RemoveFromList(buy_stops_[price], stop);
+        if (buy_stops_[price].head == nullptr) {
+            clear_bit(price, buy_stops_bitmap_);
+            if (price == lowest_buy_stop_)
+                lowest_buy_stop_ = scan_up(buy_stops_bitmap_, price, price_limit_);
+        }
+    } else {
+        RemoveFromList(sell_stops_[price], stop);
+        if (sell_stops_[price].head == nullptr) {
+            clear_bit(price, sell_stops_bitmap_);
+            if (price == highest_sell_stop_)
+                highest_sell_stop_ = scan_down(sell_stops_bitmap_, price, Price(0));
+        }
+    }
+    Unmap(order_id);
+    stop_pool_.DeleteOrder(stop);
+    pending_--;
+    return true;
+}
+
+bool StopBook::PopTriggered(Price last_price, StopOrder_V6& out) {
+    if (pending_ == 0) return false;
+
+    if (lowest_buy_stop_ < price_limit_ && lowest_buy_stop_ <= last_price) {
+        Price price = lowest_buy_stop_;
+        StopLevel_V6& level = buy_stops_[price];
+        StopOrder_V6* stop = level.head;
+        RemoveFromList(level, stop);
+        if (level.head == nullptr) {
+            clear_bit(price, buy_stops_bitmap_);
+            lowest_buy_stop_ = scan_up(buy_stops_bitmap_, price, price_limit_);
+        }
+        Release(stop, out);
+        return true;
+    }
+
+    if (highest_sell_stop_ > 0 && highest_sell_stop_ >= last_price) {
+        Price price = highest_sell_stop_;
+        StopLevel_V6& level = sell_stops_[price];
+        StopOrder_V6* stop = level.head;
+        RemoveFromList(level, stop);
+        if (level.head == nullptr) {
+            clear_bit(price, sell_stops_bitmap_);
+            highest_sell_stop_ = scan_down(sell_stops_bitmap_, price, Price(0));
+        }
+        Release(stop, out);
+        return true;
+    }
+    return false;
+}
+
+void StopBook::Release(StopOrder_V6* stop, StopOrder_V6& out) {
+    out = *stop;
+    out.next = out.prev = nullptr;
+    Unmap(stop->order_id);
+    stop_pool_.DeleteOrder(stop);
+    pending_--;
+}
+
+StopOrder_V6* StopBook::Find(OrderId order_id) const {
+    if (order_id < stop_map_.size()) return stop_map_[order_id];
+    if (stop_overflow_.empty()) return nullptr;
+    auto it = stop_overflow_.find(order_id);
+    return it == stop_overflow_.end() ? nullptr : it->second;
+}
+
+void StopBook::Unmap(OrderId order_id) {
+    if (order_id < stop_map_.size()) {
+        stop_map_[order_id] = nullptr;
+    } else {
+        stop_overflow_.erase(order_id);
+    }
+}
+
+void StopBook::AddToList(StopLevel_V6& level, StopOrder_V6* stop) {
+    if (level.head == nullptr) {
+        level.head = level.tail = stop;
+    } else {
+        level.tail->next = stop;
+        stop->prev = level.tail;
+        level.tail = stop;
+    }
+}
+
+void StopBook::RemoveFromList(StopLevel_V6& level, StopOrder_V6* stop) {
+    if (stop->prev) stop->prev->next = stop->next;
+    if (stop->next) stop->next->prev = stop->prev;
+    if (level.head == stop) level.head = stop->next;
+    if (level.tail == stop) level.tail = stop->prev;
+    stop->next = stop->prev = nullptr;
+}
+
+void StopBook::Prefault() {
+    buy_stops_.Prefault();
+    sell_stops_.Prefault();
+    stop_pool_.Prefault();
+    stop_map_.Prefault();
+}
+
+void StopBook::AppendMemoryUse(std::vector<MemoryUse>& out) const {
+    out.push_back({"stop levels", buy_stops_.Bytes() + sell_stops_.Bytes(),
+                   ResidentBytes(buy_stops_.data(), buy_stops_.Bytes()) +
+                       ResidentBytes(sell_stops_.data(), sell_stops_.Bytes())});
+    stop_pool_.AppendMemoryUse("stop pool", out);
+    out.push_back({"stop index", stop_map_.Bytes(),
+                   ResidentBytes(stop_map_.data(), stop_map_.Bytes())});
+}
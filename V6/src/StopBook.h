@@ -0,0 +1,74 @@
+#pragma once
+
+#include "HP_Types.h"
+#include "MemoryFootprint.h"
+#include "ObjectPool.h"
+#include <unordered_map>
+#include <vector>
+
+// A pending stop. Stop-market orders carry a limit at the far end of the
+// book and are flagged so that any unfilled remainder is dropped, not rested.
+struct StopOrder_V6 {
+  OrderId order_id;
+  Quantity quantity;
+  Price stop_price;
+  Price limit_price;
+  Side side;
+  bool is_market;
+  StopOrder_V6 *next = nullptr;
+  StopOrder_V6 *prev = nullptr;
+};
+
+struct StopLevel_V6 {
+  StopOrder_V6 *head = nullptr;
+  StopOrder_V6 *tail = nullptr;
+};
+
+// Pending stops indexed by stop price, with the same bitmap layout as the
+// resting book. Buy stops fire when the last trade rises to their stop
+// price, so the lowest one is tracked (like asks_.best); sell stops fire on
+// the way down, so the highest one is tracked (like bids_.best). With no
+// stops pending those are the book's price_limit and 0, so stop prices must
+// lie in between; BasicOrderBookV6::AddStop refuses the rest. Sized from the
+// book's BookSizing, in the default widths whatever the book's traits.
+class StopBook {
+public:
+  explicit StopBook(const BookSizing &sizing);
+  void Add(OrderId order_id, Side side, Price stop_price, Price limit_price,
+           Quantity quantity, bool is_market);
+  bool Cancel(OrderId order_id);
+
+  // Pops the next stop released by a trade at last_price. Buy stops come out
+  // lowest stop price first and sell stops highest first, FIFO within a
+  // price, which is the order in which the market crossed them.
+  bool PopTriggered(Price last_price, StopOrder_V6 &out);
+
+  bool HasPending() const { return pending_ != 0; }
+
+  void Prefault();
+  void AppendMemoryUse(std::vector<MemoryUse> &out) const;
+
+private:
+  void AddToList(StopLevel_V6 &level, StopOrder_V6 *stop);
+  void RemoveFromList(StopLevel_V6 &level, StopOrder_V6 *stop);
+  void Release(StopOrder_V6 *stop, StopOrder_V6 &out);
+  StopOrder_V6 *Find(OrderId order_id) const;
+  void Unmap(OrderId order_id);
+
+  LazyArray<StopLevel_V6> buy_stops_;
+  LazyArray<StopLevel_V6> sell_stops_;
+
+  ObjectPool<StopOrder_V6> stop_pool_;
+  // Ids below the sizing's order_id_limit are looked up directly; larger
+  // ones (a hashed book's ids have no bound) go in stop_overflow_.
+  LazyArray<StopOrder_V6 *> stop_map_;
+  std::unordered_map<OrderId, StopOrder_V6 *> stop_overflow_;
+
+  Price price_limit_;
+  Price lowest_buy_stop_;
+  Price highest_sell_stop_;
+  size_t pending_;
+
+  std::vector<uint64_t> buy_stops_bitmap_;
+  std::vector<uint64_t> sell_stops_bitmap_;
+};
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+// Streaming input for files too large to map whole. Both readers hand out
+// spans of complete lines, in file order, through
+//   bool Next(const char *&begin, const char *&end)
+// and drop what has been consumed from the page cache, so memory use stays
+// at a couple of windows however large the file is. A line may not be
+// longer than MAX_LINE bytes.
+constexpr size_t MAX_LINE = 4096;
+
+// Maps the file one window at a time. Each window starts at the page
+// holding the first line not yet handed out, so a line split by the end of
+// one window is simply mapped again, whole, at the start of the next. The
+// next window is requested with readahead() while this one is parsed.
+class MmapStreamReader {
+public:
+  MmapStreamReader(int fd, size_t window) : fd_(fd) {
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    page_mask_ = ~(static_cast<uint64_t>(page) - 1);
+    window_ = std::max<size_t>(window & page_mask_, 2 * MAX_LINE + page);
+    struct stat sb;
+    file_size_ = fstat(fd, &sb) == 0 ? static_cast<uint64_t>(sb.st_size) : 0;
+  }
+  ~MmapStreamReader() { Unmap(); }
+  MmapStreamReader(const MmapStreamReader &) = delete;
+  MmapStreamReader &operator=(const MmapStreamReader &) = delete;
+
+  bool Next(const char *&begin, const char *&end) {
+    Unmap();
+    if (offset_ >= file_size_) return false;
+
+    uint64_t map_start = offset_ & page_mask_;
+    size_t length = static_cast<size_t>(
+        std::min<uint64_t>(window_, file_size_ - map_start));
+    void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd_,
+                        static_cast<off_t>(map_start));
+    if (mapped == MAP_FAILED) {
+      std::perror("mmap");
+      return false;
+    }
+    map_ = static_cast<char *>(mapped);
+    map_length_ = length;
+    madvise(map_, map_length_, MADV_SEQUENTIAL);
+
+    const uint64_t map_end = map_start + length;
+    if (map_end < file_size_) {
+      readahead(fd_, static_cast<off64_t>(map_end), window_);
+    }
+
+    begin = map_ + (offset_ - map_start);
+    end = map_ + length;
+    if (map_end < file_size_) {
+      // Stop after the last complete line; the rest comes next time.
+      while (end > begin && end[-1] != '\n') --end;
+    }
+    offset_ = map_start + static_cast<uint64_t>(end - map_);
+    return end > begin;
+  }
+
+private:
+  void Unmap() {
+    if (!map_) return;
+    munmap(map_, map_length_);
+    // Everything before the first unconsumed page is done with.
+    uint64_t consumed = offset_ & page_mask_;
+    if (consumed > dropped_) {
+      posix_fadvise(fd_, static_cast<off_t>(dropped_),
+                    static_cast<off_t>(consumed - dropped_),
+                    POSIX_FADV_DONTNEED);
+      dropped_ = consumed;
+    }
+    map_ = nullptr;
+  }
+
+  int fd_;
+  uint64_t page_mask_;
+  size_t window_;
+  uint64_t file_size_ = 0;
+  uint64_t offset_ = 0;
+  uint64_t dropped_ = 0;
+  char *map_ = nullptr;
+  size_t map_length_ = 0;
+};
+
+// Double-buffered reads through io_uring, driven by raw syscalls (no
+// liburing). While one buffer is parsed the kernel fills the other. Each
+// buffer has MAX_LINE bytes of room in front of its data, where the
+// unfinished last line of the previous buffer is copied before the two are
+// handed out as one span.
+class UringStreamReader {
+public:
+  UringStreamReader(int fd, size_t buffer_size)
+      : fd_(fd), buffer_size_(buffer_size) {
+    for (std::vector<char> &buffer : buffers_) {
+      buffer.resize(MAX_LINE + buffer_size_);
+    }
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, 4, &params));
+    if (ring_fd_ < 0) {
+      std::perror("io_uring_setup");
+      return;
+    }
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(
+        mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED ||
+        sqes_ == MAP_FAILED) {
+      std::perror("mmap io_uring");
+      close(ring_fd_);
+      ring_fd_ = -1;
+      return;
+    }
+    char *sq = static_cast<char *>(sq_ring_);
+    char *cq = static_cast<char *>(cq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    Submit(0);
+  }
+  ~UringStreamReader() {
+    if (ring_fd_ < 0) return;
+    // A read may still be in flight into the other buffer.
+    if (in_flight_) Wait();
+    munmap(sqes_, sqes_size_);
+    munmap(cq_ring_, cq_ring_size_);
+    munmap(sq_ring_, sq_ring_size_);
+    close(ring_fd_);
+  }
+  UringStreamReader(const UringStreamReader &) = delete;
+  UringStreamReader &operator=(const UringStreamReader &) = delete;
+
+  bool Ok() const { return ring_fd_ >= 0; }
+
+  bool Next(const char *&begin, const char *&end) {
+    if (ring_fd_ < 0 || !in_flight_) return false;
+    const int current = in_flight_buffer_;
+    int bytes = Wait();
+    if (bytes < 0) {
+      errno = -bytes;
+      std::perror("io_uring read");
+      return false;
+    }
+    char *data = buffers_[current].data() + MAX_LINE;
+    bool eof = bytes == 0;
+    // Start the next read before parsing this buffer.
+    if (!eof) Submit(1 - current);
+
+    char *start = data - carry_.size();
+    std::memcpy(start, carry_.data(), carry_.size());
+    char *stop = data + bytes;
+    if (!eof) {
+      char *line_end = stop;
+      while (line_end > start && line_end[-1] != '\n') --line_end;
+      carry_.assign(line_end, stop);
+      if (carry_.size() > MAX_LINE) {
+        std::fprintf(stderr, "line longer than %zu bytes\n", MAX_LINE);
+        return false;
+      }
+      stop = line_end;
+    } else {
+      // A last line without its newline gets one, so the parser stops
+      // there rather than in what the buffer held before.
+      if (stop > start) *stop++ = '\n';
+      carry_.clear();
+    }
+    if (bytes > 0 && offset_ > dropped_) {
+      posix_fadvise(fd_, static_cast<off_t>(dropped_),
+                    static_cast<off_t>(offset_ - dropped_), POSIX_FADV_DONTNEED);
+      dropped_ = offset_;
+    }
+    begin = start;
+    end = stop;
+    if (begin == end && !eof) return Next(begin, end);
+    return begin != end;
+  }
+
+private:
+  void Submit(int buffer) {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe &sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = fd_;
+    sqe.addr = reinterpret_cast<uint64_t>(buffers_[buffer].data() + MAX_LINE);
+    sqe.len = static_cast<uint32_t>(buffer_size_);
+    sqe.off = submit_offset_;
+    sqe.user_data = static_cast<uint64_t>(buffer);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0);
+    in_flight_ = true;
+    in_flight_buffer_ = buffer;
+  }
+
+  // Waits for the outstanding read; returns its result (bytes or -errno).
+  int Wait() {
+    unsigned head = *cq_head_;
+    while (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS,
+              nullptr, 0);
+    }
+    int result = cqes_[head & cq_mask_].res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    in_flight_ = false;
+    if (result > 0) {
+      offset_ = submit_offset_ + static_cast<uint64_t>(result);
+      submit_offset_ = offset_;
+    }
+    return result;
+  }
+
+  int fd_;
+  size_t buffer_size_;
+  std::vector<char> buffers_[2];
+  std::vector<char> carry_;
+  int ring_fd_ = -1;
+  void *sq_ring_ = nullptr;
+  void *cq_ring_ = nullptr;
+  io_uring_sqe *sqes_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  size_t cq_ring_size_ = 0;
+  size_t sqes_size_ = 0;
+  unsigned *sq_tail_ = nullptr;
+  unsigned *sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+  bool in_flight_ = false;
+  int in_flight_buffer_ = 0;
+  uint64_t submit_offset_ = 0;
+  uint64_t offset_ = 0;
+  uint64_t dropped_ = 0;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "HP_Types.h"
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+
+// Fixed-point decimal price: an integer count of 10^-PRICE_DECIMALS units,
+// so 101.25 is stored as 1012500.
+using DecimalPrice = int64_t;
+constexpr unsigned PRICE_DECIMALS = 4;
+constexpr DecimalPrice PRICE_SCALE = 10000;
+
+constexpr size_t MAX_TICK_TIERS = 8;
+
+// One band of a tick schedule: prices from `from` up to the next tier's
+// `from` trade in multiples of `tick_size`.
+struct TickTier {
+  DecimalPrice from;
+  DecimalPrice tick_size;
+};
+
+// Per-instrument tick schedule that maps decimal prices onto the dense
+// level index used by the book's bids_/asks_ arrays and bitmaps. Level 0 is
+// left unused because the book treats it as "no bid", so the lowest valid
+// price maps to level 1 and the index stays below MAX_PRICE.
+//
+// Conversion happens once, at ingress. Division by the tick size is
+// replaced by a multiply with a precomputed reciprocal: with
+// m = floor(2^63 / tick) + 1, (offset * m) >> 63 equals offset / tick for
+// every offset < 2^31 and tick < 2^32, which the constructor enforces.
+class TickTable {
+public:
+  TickTable(std::initializer_list<TickTier> tiers, DecimalPrice max_price)
+      : num_tiers_(0) {
+    if (tiers.size() == 0 || tiers.size() > MAX_TICK_TIERS) {
+      throw std::invalid_argument("TickTable: bad tier count");
+    }
+    Price base_level = 1;
+    const TickTier *tier = tiers.begin();
+    for (size_t i = 0; i < tiers.size(); ++i, ++tier) {
+      DecimalPrice to = (i + 1 < tiers.size()) ? tier[1].from : max_price;
+      DecimalPrice span = to - tier->from;
+      if (tier->tick_size <= 0 || tier->tick_size >= (DecimalPrice(1) << 32) ||
+          span <= 0 || span >= (DecimalPrice(1) << 31) ||
+          span % tier->tick_size != 0) {
+        throw std::invalid_argument("TickTable: bad tier");
+      }
+      Tier &t = tiers_[num_tiers_++];
+      t.from = tier->from;
+      t.to = to;
+      t.tick_size = tier->tick_size;
+      t.reciprocal = (uint64_t(1) << 63) / uint64_t(tier->tick_size) + 1;
+      t.base_level = base_level;
+      base_level += static_cast<Price>(span / tier->tick_size);
+    }
+    // The last tier includes max_price itself.
+    max_level_ = base_level;
+    if (max_level_ >= MAX_PRICE) {
+      throw std::invalid_argument("TickTable: more levels than MAX_PRICE");
+    }
+  }
+
+  // Single uniform tick, e.g. TickTable::Uniform(25, 0, 1000000) for a
+  // 0.0025 tick between 0 and 100.
+  static TickTable Uniform(DecimalPrice tick_size, DecimalPrice min_price,
+                           DecimalPrice max_price) {
+    return TickTable({{min_price, tick_size}}, max_price);
+  }
+
+  // Returns false for prices outside the table or off the tick grid.
+  bool ToLevel(DecimalPrice price, Price &level) const {
+    if (price < tiers_[0].from) return false;
+    const Tier *tier = &tiers_[0];
+    const Tier *last = &tiers_[num_tiers_ - 1];
+    while (price >= tier->to && tier != last) ++tier;
+    if (price > last->to) return false;
+
+    uint64_t offset = uint64_t(price - tier->from);
+    uint64_t ticks =
+        static_cast<uint64_t>((unsigned __int128)offset * tier->reciprocal >> 63);
+    if (ticks * uint64_t(tier->tick_size) != offset) return false;
+    level = tier->base_level + static_cast<Price>(ticks);
+    return true;
+  }
+
+  DecimalPrice ToPrice(Price level) const {
+    const Tier *tier = &tiers_[num_tiers_ - 1];
+    while (level < tier->base_level && tier != &tiers_[0]) --tier;
+    return tier->from + DecimalPrice(level - tier->base_level) * tier->tick_size;
+  }
+
+  Price MaxLevel() const { return max_level_; }
+
+private:
+  struct Tier {
+    DecimalPrice from;
+    DecimalPrice to;
+    DecimalPrice tick_size;
+    uint64_t reciprocal;
+    Price base_level;
+  };
+
+  std::array<Tier, MAX_TICK_TIERS> tiers_;
+  size_t num_tiers_;
+  Price max_level_;
+};
@@ -0,0 +1,148 @@
+#include "TimerWheel.h"
+#include "PriceBitmap.h"
+#include <algorithm>
+
+TimerWheel::TimerWheel(Timestamp now, size_t capacity)
+    : nodes_(std::max<size_t>(capacity, 2)),
+      used_(1),
+      free_(0),
+      heads_(),
+      occupied_(),
+      summary_(),
+      now_(now),
+      next_start_(UINT64_MAX),
+      pending_(0) {}
+
+uint32_t TimerWheel::Add(void* order, Timestamp expiry) {
+    uint32_t handle = Allocate();
+    nodes_[handle].expiry = expiry;
+    nodes_[handle].order = order;
+    Schedule(handle);
+    pending_++;
+    return handle;
+}
+
+void TimerWheel::Remove(uint32_t handle) {
+    Unlink(handle);
+    nodes_[handle].order = nullptr;
+    nodes_[handle].next = free_;
+    free_ = handle;
+    pending_--;
+}
+
+bool TimerWheel::PopExpired(Timestamp now, void*& out) {
+    while (heads_[DUE] == 0) {
+        if (now < next_start_ || !TakeNextSlot(now)) {
+            now_ = std::max(now_, now);
+            return false;
+        }
+    }
+    uint32_t handle = heads_[DUE];
+    out = nodes_[handle].order;
+    Remove(handle);
+    // The caller is about to unlink `out`; start on the next one's order.
+    if (heads_[DUE] != 0) __builtin_prefetch(nodes_[heads_[DUE]].order);
+    return true;
+}
+
+// Empties the earliest occupied slot if it starts at or before `now`, and
+// moves book time to its start: timers expiring exactly then become due,
+// the rest go back in on a lower level.
+bool TimerWheel::TakeNextSlot(Timestamp now) {
+    for (unsigned level = 0; level < LEVELS; ++level) {
+        const unsigned shift = level * SLOT_BITS;
+        size_t slot = NextOccupied(level, (now_ >> shift) & (SLOTS - 1));
+        if (slot == SLOTS) continue;
+
+        const unsigned turn = shift + SLOT_BITS;
+        Timestamp start = (turn >= 64 ? 0 : now_ >> turn << turn) | (Timestamp(slot) << shift);
+        if (start > now) {
+            next_start_ = start;
+            return false;
+        }
+        now_ = start;
+
+        uint32_t bucket = static_cast<uint32_t>(level * SLOTS + slot);
+        uint32_t handle = heads_[bucket];
+        heads_[bucket] = 0;
+        MarkEmpty(bucket);
+        while (handle != 0) {
+            uint32_t next = nodes_[handle].next;
+            if (nodes_[handle].expiry == now_) Link(handle, DUE);
+            else Schedule(handle);
+            handle = next;
+        }
+        return true;
+    }
+    next_start_ = UINT64_MAX;
+    return false;
+}
+
+// First occupied slot of `level` after `slot`, or SLOTS. Slots at or before
+// the current one belong to the level's next turn, which a higher level
+// still holds.
+size_t TimerWheel::NextOccupied(unsigned level, size_t slot) const {
+    const uint64_t* words = occupied_ + level * WORDS;
+    size_t from = slot + 1;
+    if (from == SLOTS) return SLOTS;
+    size_t index = from >> 6;
+    uint64_t chunk = words[index] & (~0ULL << (from & 63));
+    if (chunk != 0) return (index << 6) + BUILTIN_CTZLL(chunk);
+    uint64_t later = index + 1 < WORDS ? summary_[level] & (~0ULL << (index + 1)) : 0;
+    if (later == 0) return SLOTS;
+    index = BUILTIN_CTZLL(later);
+    return (index << 6) + BUILTIN_CTZLL(words[index]);
+}
+
+// The highest level at which expiry and now_ differ; expiry is the later,
+// so its slot there is ahead of the current one.
+void TimerWheel::Schedule(uint32_t handle) {
+    Timestamp expiry = nodes_[handle].expiry;
+    unsigned level = (63 - BUILTIN_CLZLL(expiry ^ now_)) / SLOT_BITS;
+    size_t slot = (expiry >> (level * SLOT_BITS)) & (SLOTS - 1);
+    Link(handle, static_cast<uint32_t>(level * SLOTS + slot));
+    // The slot opens when the time reaches expiry with the lower bits clear.
+    next_start_ = std::min(next_start_, expiry >> (level * SLOT_BITS) << (level * SLOT_BITS));
+}
+
+uint32_t TimerWheel::Allocate() {
+    if (free_ != 0) {
+        uint32_t handle = free_;
+        free_ = nodes_[handle].next;
+        return handle;
+    }
+    if (used_ == nodes_.size()) nodes_.Grow(nodes_.size() * 2);
+    return used_++;
+}
+
+void TimerWheel::Link(uint32_t handle, uint32_t bucket) {
+    TimerNode& node = nodes_[handle];
+    node.bucket = bucket;
+    node.prev = 0;
+    node.next = heads_[bucket];
+    if (node.next != 0) nodes_[node.next].prev = handle;
+    heads_[bucket] = handle;
+    if (bucket != DUE) {
+        occupied_[bucket >> 6] |= 1ULL << (bucket & 63);
+        summary_[bucket / SLOTS] |= 1ULL << ((bucket >> 6) % WORDS);
+    }
+}
+
+void TimerWheel::MarkEmpty(uint32_t bucket) {
+    occupied_[bucket >> 6] &= ~(1ULL << (bucket & 63));
+    if (occupied_[bucket >> 6] == 0) summary_[bucket / SLOTS] &= ~(1ULL << ((bucket >> 6) % WORDS));
+}
+
+void TimerWheel::Unlink(uint32_t handle) {
+    TimerNode& node = nodes_[handle];
+    if (node.prev != 0) nodes_[node.prev].next = node.next;
+    else heads_[node.bucket] = node.next;
+    if (node.next != 0) nodes_[node.next].prev = node.prev;
+    if (heads_[node.bucket] == 0 && node.bucket != DUE) MarkEmpty(node.bucket);
+}
+
+void TimerWheel::AppendMemoryUse(std::vector<MemoryUse>& out) const {
+    const size_t wheel_bytes = sizeof(heads_) + sizeof(occupied_) + sizeof(summary_);
+    out.push_back({"timer wheel", nodes_.Bytes() + wheel_bytes,
+                   ResidentBytes(nodes_.data(), nodes_.Bytes()) + wheel_bytes});
+}
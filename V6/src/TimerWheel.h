@@ -0,0 +1,92 @@
+#pragma once
+
+#include "HP_Types.h"
+#include "MemoryFootprint.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Book time for order expiry, in whatever unit the caller stamps its
+// messages with (BasicOrderBookV6::AdvanceTime).
+using Timestamp = uint64_t;
+
+// GTC rests until filled or cancelled, DAY until the session close, GTD
+// until its own expiry time.
+enum class TimeInForce { GTC, DAY, GTD };
+
+struct TimerNode {
+  Timestamp expiry;
+  void *order; // the book's order node; the wheel never looks inside it
+  uint32_t next;
+  uint32_t prev;
+  uint32_t bucket; // level * SLOTS + slot, or DUE
+};
+
+// Expiry times of resting orders, as a hierarchical timing wheel over the
+// full 64-bit time range: LEVELS wheels of SLOTS slots, level l covering
+// bits [SLOT_BITS * l, SLOT_BITS * (l + 1)) of the time. A timer goes on
+// the highest level at which its expiry differs from the current time, in
+// the slot for its bits at that level, so every level only holds timers
+// for the current turn of the one above and no overflow list is needed.
+// Adding and removing a timer is O(1) list surgery on the slot; nothing
+// is sorted.
+//
+// Advancing jumps straight to the next occupied slot (each level keeps an
+// occupancy bitmap, and the first level with a slot ahead always holds the
+// earliest one), expires a level-0 slot whole and redistributes a higher
+// slot's timers to lower levels. A timer moves down at most LEVELS - 1
+// times, so expiring a batch costs O(expired), however long the gap
+// between calls. Timers are referred to by 32-bit handles, which each
+// order keeps in its `timer` field (BookSide.h); 0 means none.
+class TimerWheel {
+public:
+  static constexpr unsigned SLOT_BITS = 12;
+  static constexpr size_t SLOTS = size_t(1) << SLOT_BITS;
+  static constexpr unsigned LEVELS = (64 + SLOT_BITS - 1) / SLOT_BITS;
+
+  explicit TimerWheel(Timestamp now, size_t capacity = 4096);
+
+  // `expiry` must be later than Now().
+  uint32_t Add(void *order, Timestamp expiry);
+  void Remove(uint32_t handle);
+
+  // Pops the next order whose expiry is at or before `now`, earliest first;
+  // its handle is free again, and the caller clears the order's copy. Call
+  // it until it returns false; book time is then `now`.
+  bool PopExpired(Timestamp now, void *&out);
+
+  Timestamp Now() const { return now_; }
+  size_t Pending() const { return pending_; }
+  // For VerifyInvariants: `handle` is live and belongs to `order`.
+  bool Holds(uint32_t handle, const void *order) const {
+    return handle != 0 && handle < used_ && nodes_[handle].order == order;
+  }
+
+  void AppendMemoryUse(std::vector<MemoryUse> &out) const;
+
+private:
+  static constexpr size_t WORDS = SLOTS / 64;
+  static_assert(WORDS <= 64, "one summary word per level");
+  // Timers of the slot being expired, waiting for PopExpired.
+  static constexpr uint32_t DUE = LEVELS * SLOTS;
+
+  uint32_t Allocate();
+  void Link(uint32_t handle, uint32_t bucket);
+  void MarkEmpty(uint32_t bucket);
+  void Unlink(uint32_t handle);
+  void Schedule(uint32_t handle);
+  bool TakeNextSlot(Timestamp now);
+  size_t NextOccupied(unsigned level, size_t slot) const;
+
+  LazyArray<TimerNode> nodes_; // nodes_[0] is never handed out
+  uint32_t used_;              // nodes handed out so far, including 0
+  uint32_t free_;              // recycled nodes, linked through `next`
+  uint32_t heads_[LEVELS * SLOTS + 1];
+  uint64_t occupied_[LEVELS * WORDS];
+  uint64_t summary_[LEVELS]; // bit w: occupied word w of the level is non-zero
+  Timestamp now_;
+  // No slot opens before this (removals can leave it early), so most
+  // PopExpired calls return without looking at the bitmaps.
+  Timestamp next_start_;
+  size_t pending_;
+};
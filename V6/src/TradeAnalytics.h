@@ -0,0 +1,271 @@
+#pragma once
+
+// Bars, VWAP and volume at price computed from the book's own fills, off
+// the matching thread. A book with EnableFillStream pushes every fill into
+// a FillRing (one SpscQueue push, never a wait); an AnalyticsStage thread
+// pops them into TradeAnalytics, which keeps per-symbol state in windows
+// sized once at construction. Several books may share a ring as long as
+// they are driven from one thread, each with its own symbol id.
+
+#include "HP_Types.h"
+#include "Queues.h"
+#include "MemoryFootprint.h"
+#include "TimerWheel.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// One execution, stamped with book time (AdvanceTime). A sweep yields one
+// Fill per resting order it takes, at that order's price; an auction
+// uncross yields one per bid/ask pair, at the uncross price.
+struct Fill {
+  Timestamp time;
+  Price price;
+  Quantity quantity;
+  uint32_t symbol;
+};
+
+constexpr size_t FILL_RING_SIZE = size_t(1) << 18;
+using FillRing = SpscQueue<Fill, FILL_RING_SIZE>;
+
+// One bar_width of trading. A bar no fill landed in has trades == 0 and
+// only its start set.
+struct Bar {
+  Timestamp start;
+  Price open;
+  Price high;
+  Price low;
+  Price close;
+  uint32_t trades;
+  uint64_t volume;
+  uint64_t notional; // sum of price * quantity
+  double Vwap() const { return volume ? double(notional) / volume : 0.0; }
+};
+
+struct AnalyticsConfig {
+  uint32_t symbols = 1;
+  Timestamp bar_width = 1000000;
+  size_t window_bars = 60;
+  // Fills are priced below this: the feeding book's PriceLimit().
+  Price price_limit = MAX_PRICE;
+  // Fills remembered per symbol to age volume at price out of the window;
+  // if the window holds more, the oldest leave early (HistoryOverflows).
+  size_t fill_history = size_t(1) << 16;
+};
+
+// Per symbol: a ring of the last window_bars bars, with volume and
+// notional summed over the window; session totals; and volume at each
+// price over the same window, backed by a ring of the fills in it. Fills
+// must arrive in time order per symbol; a late one counts in the current
+// bar. Not thread-safe: one thread applies and queries (or query after
+// AnalyticsStage::Stop).
+class TradeAnalytics {
+public:
+  explicit TradeAnalytics(const AnalyticsConfig &config)
+      : bar_width_(config.bar_width), window_bars_(config.window_bars),
+        history_capacity_(config.fill_history),
+        price_limit_(config.price_limit), history_overflows_(0) {
+    symbols_.reserve(config.symbols);
+    for (uint32_t s = 0; s < config.symbols; ++s) {
+      symbols_.emplace_back(window_bars_, price_limit_, history_capacity_);
+    }
+  }
+
+  void Apply(const Fill &fill) {
+    Symbol &symbol = symbols_[fill.symbol];
+    const Timestamp start = fill.time - fill.time % bar_width_;
+    if (symbol.trades == 0) {
+      symbol.current_start = start;
+      symbol.bars[Slot(start)].start = start;
+    } else if (start > symbol.current_start) {
+      Roll(symbol, start);
+    }
+
+    Bar &bar = symbol.bars[Slot(symbol.current_start)];
+    if (bar.trades == 0) bar.open = bar.high = bar.low = fill.price;
+    bar.high = std::max(bar.high, fill.price);
+    bar.low = std::min(bar.low, fill.price);
+    bar.close = fill.price;
+    bar.trades++;
+    const uint64_t notional = uint64_t(fill.price) * fill.quantity;
+    bar.volume += fill.quantity;
+    bar.notional += notional;
+    symbol.window_volume += fill.quantity;
+    symbol.window_notional += notional;
+    symbol.session_volume += fill.quantity;
+    symbol.session_notional += notional;
+    symbol.trades++;
+
+    if (symbol.history_size == history_capacity_) {
+      PopHistory(symbol);
+      history_overflows_++;
+    }
+    size_t tail = (symbol.history_head + symbol.history_size) % history_capacity_;
+    symbol.history[tail] = {std::max(fill.time, symbol.current_start),
+                            fill.price, fill.quantity};
+    symbol.history_size++;
+    symbol.volume_at_price[fill.price] += fill.quantity;
+  }
+
+  // Newest first, from the current bar back through the window.
+  size_t RecentBars(uint32_t symbol_id, Bar *out, size_t max_bars) const {
+    const Symbol &symbol = symbols_[symbol_id];
+    if (symbol.trades == 0) return 0;
+    size_t count = 0;
+    Timestamp start = symbol.current_start;
+    while (count < std::min(max_bars, window_bars_)) {
+      out[count++] = symbol.bars[Slot(start)];
+      if (start < bar_width_) break;
+      start -= bar_width_;
+    }
+    return count;
+  }
+
+  uint64_t WindowVolume(uint32_t symbol) const {
+    return symbols_[symbol].window_volume;
+  }
+  double WindowVwap(uint32_t symbol) const {
+    const Symbol &s = symbols_[symbol];
+    return s.window_volume ? double(s.window_notional) / s.window_volume : 0.0;
+  }
+  uint64_t SessionVolume(uint32_t symbol) const {
+    return symbols_[symbol].session_volume;
+  }
+  double SessionVwap(uint32_t symbol) const {
+    const Symbol &s = symbols_[symbol];
+    return s.session_volume ? double(s.session_notional) / s.session_volume
+                            : 0.0;
+  }
+  // Over the same window as the bars; price must be below PriceLimit().
+  uint64_t VolumeAtPrice(uint32_t symbol, Price price) const {
+    return symbols_[symbol].volume_at_price[price];
+  }
+  uint64_t HistoryOverflows() const { return history_overflows_; }
+  Price PriceLimit() const { return price_limit_; }
+
+private:
+  struct Trade {
+    Timestamp time;
+    Price price;
+    Quantity quantity;
+  };
+
+  struct Symbol {
+    Symbol(size_t window_bars, Price price_limit, size_t history_capacity)
+        : bars(window_bars), volume_at_price(price_limit),
+          history(history_capacity) {}
+
+    LazyArray<Bar> bars; // indexed by Slot(bar start)
+    Timestamp current_start = 0;
+    uint64_t trades = 0;
+    uint64_t window_volume = 0;
+    uint64_t window_notional = 0;
+    uint64_t session_volume = 0;
+    uint64_t session_notional = 0;
+    LazyArray<uint64_t> volume_at_price;
+    LazyArray<Trade> history; // ring: history_size fills from history_head
+    size_t history_head = 0;
+    size_t history_size = 0;
+  };
+
+  size_t Slot(Timestamp start) const {
+    return (start / bar_width_) % window_bars_;
+  }
+
+  // Opens the bar at `start`. Every slot between the old and the new bar
+  // is reused, so the bars they held leave the window, and so do the
+  // fills older than its first bar.
+  void Roll(Symbol &symbol, Timestamp start) {
+    const Timestamp gap = (start - symbol.current_start) / bar_width_;
+    const size_t reused = gap < window_bars_ ? gap : window_bars_;
+    for (size_t k = reused; k > 0; --k) {
+      Bar &bar = symbol.bars[Slot(start - (k - 1) * bar_width_)];
+      symbol.window_volume -= bar.volume;
+      symbol.window_notional -= bar.notional;
+      bar = Bar{};
+      bar.start = start - (k - 1) * bar_width_;
+    }
+    symbol.current_start = start;
+
+    const Timestamp span = (window_bars_ - 1) * bar_width_;
+    const Timestamp window_start = start > span ? start - span : 0;
+    while (symbol.history_size > 0 &&
+           symbol.history[symbol.history_head].time < window_start) {
+      PopHistory(symbol);
+    }
+  }
+
+  void PopHistory(Symbol &symbol) {
+    const Trade &oldest = symbol.history[symbol.history_head];
+    symbol.volume_at_price[oldest.price] -= oldest.quantity;
+    symbol.history_head = (symbol.history_head + 1) % history_capacity_;
+    symbol.history_size--;
+  }
+
+  Timestamp bar_width_;
+  size_t window_bars_;
+  size_t history_capacity_;
+  Price price_limit_;
+  uint64_t history_overflows_;
+  std::vector<Symbol> symbols_;
+};
+
+// The consumer side of a FillRing: a thread that applies every fill to a
+// TradeAnalytics, spinning briefly and then yielding while the ring is
+// empty (Backoff), so it costs little when trading is quiet.
+class AnalyticsStage {
+public:
+  AnalyticsStage(FillRing &ring, TradeAnalytics &analytics)
+      : ring_(ring), analytics_(analytics) {}
+  ~AnalyticsStage() { Stop(); }
+
+  void Start() {
+    thread_ = std::thread([this]() { Loop(); });
+  }
+
+  // Call once the books have stopped pushing: returns after the thread
+  // has applied everything left in the ring.
+  void Stop() {
+    stop_.store(true, std::memory_order_release);
+    if (thread_.joinable()) thread_.join();
+  }
+
+  // Applies whatever is queued on the calling thread (for use without
+  // Start, or after Stop). Returns the number of fills.
+  size_t Drain() {
+    size_t count = 0;
+    Fill fill;
+    while (ring_.TryPop(fill)) {
+      analytics_.Apply(fill);
+      count++;
+    }
+    applied_ += count;
+    return count;
+  }
+
+  uint64_t Applied() const { return applied_; }
+
+private:
+  void Loop() {
+    Backoff backoff;
+    for (;;) {
+      if (Drain() > 0) {
+        backoff = Backoff();
+      } else if (stop_.load(std::memory_order_acquire)) {
+        Drain();
+        return;
+      } else {
+        backoff.Wait();
+      }
+    }
+  }
+
+  FillRing &ring_;
+  TradeAnalytics &analytics_;
+  uint64_t applied_ = 0;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
@@ -0,0 +1,194 @@
+#include "MarketData.h"
+#include "OrderBookV6.h"
+#include "TradeAnalytics.h"
+#include "Workloads.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+// Cost of TradeAnalytics to the matcher, on the benchmark suite's
+// sweep_heavy workload (Workloads.h: one message in 50 takes 100 ticks
+// through the touch, so fills come in bursts). Book time is the message
+// index in microseconds; bars are 1 ms wide and the window holds 60.
+//
+//   book       fill stream off
+//   push only  stream into a ring that the matching thread empties without
+//              applying anything every DISCARD_EVERY messages, well before
+//              it can fill: the matcher's side of the stream with no
+//              consumer competing for the cache or CPU
+//   stream     stream into a ring drained by an AnalyticsStage thread,
+//              timed until the thread has applied the last fill
+//   inline     the same ring drained on the matching thread after every
+//              message, i.e. the analytics computed in the matching loop
+//
+// Each mode runs RUNS times, interleaved, and the median is reported. The
+// stream and inline analytics must agree (bars, VWAPs, volume at price);
+// exit status is 1 if they don't, if any mode dropped or lost a fill, or
+// if WarmUp's synthetic trades reached the ring. On one core the stream
+// thread shares the CPU with the matcher, so its time includes the
+// analytics itself; with a core of its own it approaches push only.
+using Clock = std::chrono::steady_clock;
+
+constexpr int RUNS = 5;
+constexpr size_t PRESEED = 20000;
+// Sweeps average a few hundred fills per thousand messages here, far
+// inside FILL_RING_SIZE.
+constexpr size_t DISCARD_EVERY = 1024;
+
+enum class Mode { BOOK, PUSH_ONLY, STREAM, INLINE };
+
+AnalyticsConfig Config() {
+  AnalyticsConfig config;
+  config.bar_width = 1000;
+  config.window_bars = 60;
+  config.price_limit = OrderBookV6::DefaultSizing().price_limit;
+  return config;
+}
+
+struct AnalyticsRun {
+  double ms = 0;
+  size_t fills = 0;
+  uint64_t dropped = 0;
+  std::unique_ptr<TradeAnalytics> analytics;
+};
+
+AnalyticsRun Run(const std::vector<Message> &messages, Mode mode) {
+  AnalyticsRun result;
+  auto ring = std::make_unique<FillRing>();
+  result.analytics = std::make_unique<TradeAnalytics>(Config());
+  AnalyticsStage stage(*ring, *result.analytics);
+  auto *book = new OrderBookV6();
+  if (mode != Mode::BOOK) book->EnableFillStream(ring.get(), 0);
+
+  auto start = Clock::now();
+  if (mode == Mode::STREAM) stage.Start();
+  for (size_t i = 0; i < messages.size(); ++i) {
+    const Message &msg = messages[i];
+    book->AdvanceTime(i + 1);
+    if (msg.type == 'A') {
+      book->AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+    } else {
+      book->CancelOrder(msg.order_id);
+    }
+    if (mode == Mode::INLINE) stage.Drain();
+    if (mode == Mode::PUSH_ONLY && i % DISCARD_EVERY == 0) {
+      for (Fill fill; ring->TryPop(fill);) result.fills++;
+    }
+  }
+  if (mode == Mode::STREAM) stage.Stop();
+  result.ms =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  if (mode == Mode::PUSH_ONLY) {
+    for (Fill fill; ring->TryPop(fill);) result.fills++;
+  } else {
+    result.fills = stage.Applied();
+  }
+  result.dropped = book->FillsDropped();
+  delete book;
+  return result;
+}
+
+bool SameAnalytics(const TradeAnalytics &a, const TradeAnalytics &b) {
+  const size_t window = Config().window_bars;
+  std::vector<Bar> bars_a(window), bars_b(window);
+  size_t count = a.RecentBars(0, bars_a.data(), window);
+  if (count != b.RecentBars(0, bars_b.data(), window)) return false;
+  for (size_t i = 0; i < count; ++i) {
+    const Bar &x = bars_a[i], &y = bars_b[i];
+    if (x.start != y.start || x.open != y.open || x.high != y.high ||
+        x.low != y.low || x.close != y.close || x.trades != y.trades ||
+        x.volume != y.volume || x.notional != y.notional) {
+      return false;
+    }
+  }
+  for (Price price = 0; price < a.PriceLimit(); ++price) {
+    if (a.VolumeAtPrice(0, price) != b.VolumeAtPrice(0, price)) return false;
+  }
+  return a.WindowVolume(0) == b.WindowVolume(0) &&
+         a.WindowVwap(0) == b.WindowVwap(0) &&
+         a.SessionVolume(0) == b.SessionVolume(0) &&
+         a.SessionVwap(0) == b.SessionVwap(0);
+}
+
+// WarmUp trades, but only against its own synthetic orders.
+bool WarmUpIsSilent() {
+  auto ring = std::make_unique<FillRing>();
+  auto *book = new OrderBookV6();
+  book->EnableFillStream(ring.get(), 0);
+  book->WarmUp(10000, 10000);
+  Fill fill;
+  bool silent = !ring->TryPop(fill) && book->FillsDropped() == 0;
+  delete book;
+  return silent;
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+int main(int argc, char *argv[]) {
+  size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+  const WorkloadSpec &spec = WORKLOADS[3];
+  std::vector<Message> messages;
+  messages.reserve(PRESEED + count);
+  for (const WorkloadMessage &msg : GenerateWorkload(spec, count, PRESEED)) {
+    messages.push_back({msg.order_id, static_cast<Price>(msg.price),
+                        static_cast<Quantity>(msg.quantity), msg.type,
+                        msg.side == 'B' ? Side::BUY : Side::SELL});
+  }
+
+  const Mode modes[] = {Mode::BOOK, Mode::PUSH_ONLY, Mode::STREAM,
+                        Mode::INLINE};
+  const char *names[] = {"book", "push only", "stream", "inline"};
+  std::vector<double> ms[4];
+  AnalyticsRun last[4];
+  for (int run = 0; run < RUNS; ++run) {
+    for (int m = 0; m < 4; ++m) {
+      last[m] = Run(messages, modes[m]);
+      ms[m].push_back(last[m].ms);
+    }
+  }
+
+  const size_t fills = last[3].fills;
+  std::printf("V6 analytics: %s, %zu messages (%zu preseed), %zu fills, "
+              "median of %d runs\n",
+              spec.name, messages.size(), PRESEED, fills, RUNS);
+  std::printf("  %-10s %9s %12s %8s %10s %8s\n", "mode", "ms", "msgs/s",
+              "ns/msg", "ns/fill+", "dropped");
+  const double book_ms = Median(ms[0]);
+  for (int m = 0; m < 4; ++m) {
+    const double median = Median(ms[m]);
+    std::printf("  %-10s %9.1f %12.0f %8.1f %10.1f %8llu\n", names[m], median,
+                messages.size() / (median / 1e3), median * 1e6 / messages.size(),
+                fills ? (median - book_ms) * 1e6 / fills : 0.0,
+                (unsigned long long)last[m].dropped);
+  }
+
+  const TradeAnalytics &analytics = *last[3].analytics;
+  Bar bar{};
+  std::printf("  session vwap %.2f over %llu; window vwap %.2f over %llu",
+              analytics.SessionVwap(0),
+              (unsigned long long)analytics.SessionVolume(0),
+              analytics.WindowVwap(0),
+              (unsigned long long)analytics.WindowVolume(0));
+  if (analytics.RecentBars(0, &bar, 1) == 1) {
+    std::printf("; last bar o/h/l/c %u/%u/%u/%u", bar.open, bar.high,
+                bar.low, bar.close);
+  }
+  std::printf("\n");
+
+  bool ok = last[2].fills == fills && last[1].fills == fills &&
+            SameAnalytics(*last[2].analytics, analytics);
+  for (const AnalyticsRun &run : last) ok &= run.dropped == 0;
+  std::printf("  stream analytics %s\n",
+              ok ? "match inline" : "DIFFER from inline");
+  bool silent = WarmUpIsSilent();
+  std::printf("  warm-up %s\n",
+              silent ? "publishes no fills" : "PUBLISHED fills");
+  return ok && silent ? 0 : 1;
+}
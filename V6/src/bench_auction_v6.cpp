@@ -0,0 +1,36 @@
+#include "OrderBookV6.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+
+// Call-auction benchmark: rest N orders in auction mode around a common
+// mid so that the book crosses heavily, then time a single Uncross.
+int main() {
+  const OrderId book_sizes[] = {10000, 100000, 1000000};
+
+  for (OrderId num_orders : book_sizes) {
+    std::mt19937_64 rng(42);
+    std::normal_distribution<double> price_dist(10000.0, 50.0);
+    std::uniform_int_distribution<Quantity> qty_dist(1, 100);
+
+    auto *book = new OrderBookV6();
+    book->BeginAuction();
+    for (OrderId order_id = 1; order_id <= num_orders; ++order_id) {
+      Side side = (rng() & 1) ? Side::BUY : Side::SELL;
+      Price price = static_cast<Price>(price_dist(rng));
+      book->AddOrder(order_id, side, price, qty_dist(rng));
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    AuctionResult result = book->Uncross();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        end_time - start_time);
+
+    std::cout << "V6 Uncross (" << num_orders << " orders): "
+              << duration.count() << " us, price " << result.price
+              << ", volume " << result.volume << std::endl;
+    delete book;
+  }
+  return 0;
+}
@@ -0,0 +1,177 @@
+#include "MarketData.h"
+#include "OrderBookV6.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+// Eager vs lazy (tombstoned) cancels across cancel ratios. The generator
+// follows scripts/generate_data_dense.py (prices ~ N(10000, 25), quantity
+// 1-100, 50k pre-seeded orders) but picks add vs cancel so that
+// cancels / adds ~= the cancel ratio. The lazy book is compacted every
+// COMPACT_EVERY messages, standing in for idle periods; that time is
+// included in its total and also reported on its own.
+//
+// Each configuration is run twice: once timed end to end for throughput,
+// once timing every CancelOrder call for the latency percentiles.
+//
+// Before timing, a lazy book of each index type is checked for id reuse:
+// an id cancelled lazily and re-added at another price must stay live when
+// a sweep (or an uncross) frees the tombstone. Exit status is 1 if not.
+constexpr size_t NUM_MESSAGES = 2000000;
+constexpr size_t PRESEED_ORDERS = 50000;
+constexpr size_t COMPACT_EVERY = 50000;
+
+std::vector<Message> CancelHeavyMessages(double cancel_ratio, size_t count) {
+  std::mt19937_64 rng(7);
+  std::normal_distribution<double> price(10000.0, 25.0);
+  std::uniform_int_distribution<Quantity> quantity(1, 100);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  const double add_probability = 1.0 / (1.0 + cancel_ratio);
+
+  std::vector<Message> messages;
+  std::vector<OrderId> active;
+  messages.reserve(PRESEED_ORDERS + count);
+  OrderId order_id = 1;
+
+  for (size_t i = 0; i < PRESEED_ORDERS + count; ++i) {
+    Message msg{};
+    if (i < PRESEED_ORDERS || active.empty() || unit(rng) < add_probability) {
+      msg.type = 'A';
+      msg.side = (rng() & 1) ? Side::BUY : Side::SELL;
+      msg.price = static_cast<Price>(price(rng));
+      msg.quantity = quantity(rng);
+      msg.order_id = order_id++;
+      active.push_back(msg.order_id);
+    } else {
+      size_t index = rng() % active.size();
+      msg.type = 'C';
+      msg.order_id = active[index];
+      active[index] = active.back();
+      active.pop_back();
+    }
+    messages.push_back(msg);
+  }
+  return messages;
+}
+
+struct CancelRun {
+  double total_ms = 0;
+  double compact_ms = 0;
+  uint64_t cancel_p50_ns = 0;
+  uint64_t cancel_p99_ns = 0;
+};
+
+CancelRun Run(const std::vector<Message> &messages, bool lazy) {
+  using Clock = std::chrono::steady_clock;
+  CancelRun result;
+
+  auto *book = new OrderBookV6();
+  if (lazy) book->EnableLazyCancels();
+  Clock::duration compact_time{};
+  auto start_time = Clock::now();
+  for (size_t i = 0; i < messages.size(); ++i) {
+    const Message &msg = messages[i];
+    if (msg.type == 'A') {
+      book->AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+    } else {
+      book->CancelOrder(msg.order_id);
+    }
+    if (lazy && (i + 1) % COMPACT_EVERY == 0) {
+      auto compact_start = Clock::now();
+      book->Compact();
+      compact_time += Clock::now() - compact_start;
+    }
+  }
+  auto end_time = Clock::now();
+  result.total_ms =
+      std::chrono::duration<double, std::milli>(end_time - start_time).count();
+  result.compact_ms =
+      std::chrono::duration<double, std::milli>(compact_time).count();
+  delete book;
+
+  book = new OrderBookV6();
+  if (lazy) book->EnableLazyCancels();
+  std::vector<uint64_t> cancel_ns;
+  for (size_t i = 0; i < messages.size(); ++i) {
+    const Message &msg = messages[i];
+    if (msg.type == 'A') {
+      book->AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+    } else {
+      auto cancel_start = Clock::now();
+      book->CancelOrder(msg.order_id);
+      cancel_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              Clock::now() - cancel_start)
+                              .count());
+    }
+    if (lazy && (i + 1) % COMPACT_EVERY == 0) book->Compact();
+  }
+  delete book;
+
+  if (!cancel_ns.empty()) {
+    std::sort(cancel_ns.begin(), cancel_ns.end());
+    result.cancel_p50_ns = cancel_ns[cancel_ns.size() / 2];
+    result.cancel_p99_ns = cancel_ns[cancel_ns.size() * 99 / 100];
+  }
+  return result;
+}
+
+// Lazy-cancel 1 at 100, re-add 1 at 101, then free the tombstone at 100
+// with a sweep (or, if `uncross`, with an auction). Order 1 must still be
+// in the index and cancellable.
+template <typename Book> bool LazyIdReuseHolds(const char *name, bool uncross) {
+  auto *book = new Book();
+  book->EnableLazyCancels();
+  book->AddOrder(1, Side::SELL, 100, 10);
+  book->AddOrder(2, Side::SELL, 100, 10);
+  book->CancelOrder(1);
+  book->AddOrder(1, Side::SELL, 101, 10);
+  if (uncross) {
+    book->BeginAuction();
+    book->AddOrder(3, Side::BUY, 100, 10);
+    book->Uncross();
+  } else {
+    book->AddOrder(3, Side::BUY, 100, 10);
+  }
+  std::string error;
+  bool ok = book->VerifyInvariants(&error);
+  book->CancelOrder(1);
+  ok = ok && book->VerifyInvariants(&error);
+  DepthLevel asks[1];
+  ok = ok && book->GetDepth(Side::SELL, 1, asks) == 0;
+  if (!ok) {
+    std::fprintf(stderr, "%s lazy id reuse (%s): %s\n", name,
+                 uncross ? "uncross" : "sweep",
+                 error.empty() ? "order 1 not cancelled" : error.c_str());
+  }
+  delete book;
+  return ok;
+}
+
+int main() {
+  bool reuse_ok = LazyIdReuseHolds<OrderBookV6>("direct", false) &
+                  LazyIdReuseHolds<OrderBookV6>("direct", true) &
+                  LazyIdReuseHolds<OrderBookV6Hashed>("hashed", false) &
+                  LazyIdReuseHolds<OrderBookV6Hashed>("hashed", true);
+  if (!reuse_ok) return 1;
+
+  const double ratios[] = {0.45, 0.60, 0.75, 0.90, 0.95};
+
+  std::printf("%-7s %-6s %10s %11s %12s %12s\n", "cancel", "mode", "total ms",
+              "compact ms", "cancel p50", "cancel p99");
+  for (double ratio : ratios) {
+    std::vector<Message> messages = CancelHeavyMessages(ratio, NUM_MESSAGES);
+    CancelRun eager = Run(messages, false);
+    CancelRun lazy = Run(messages, true);
+    std::printf("%5.0f%%  %-6s %10.1f %11s %9llu ns %9llu ns\n", ratio * 100,
+                "eager", eager.total_ms, "-",
+                (unsigned long long)eager.cancel_p50_ns,
+                (unsigned long long)eager.cancel_p99_ns);
+    std::printf("%5.0f%%  %-6s %10.1f %11.1f %9llu ns %9llu ns\n",
+                ratio * 100, "lazy", lazy.total_ms, lazy.compact_ms,
+                (unsigned long long)lazy.cancel_p50_ns,
+                (unsigned long long)lazy.cancel_p99_ns);
+  }
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include "MarketData.h"
+#include "OrderBookV6.h"
+#include <chrono>
+#include <iostream>
+
+// Depth-query benchmark: replays a market data file and reads the top
+// DEPTH_CACHE_LEVELS levels of both sides, either by walking the bitmaps
+// (GetDepth) or from the cached snapshot (TopOfBook), after every message
+// or after every 1000 messages.
+enum class QueryMode { NONE, GET_DEPTH, SNAPSHOT };
+
+uint64_t Run(const std::vector<Message> &messages, QueryMode mode,
+             size_t query_every, const char *label) {
+  auto *book = new OrderBookV6();
+  if (mode == QueryMode::SNAPSHOT) book->EnableDepthCache();
+  DepthLevel bids[DEPTH_CACHE_LEVELS];
+  DepthLevel asks[DEPTH_CACHE_LEVELS];
+  uint64_t checksum = 0;
+  size_t until_query = query_every;
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+
+  for (const Message &msg : messages) {
+    if (msg.type == 'A') {
+      book->AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+    } else if (msg.type == 'C') {
+      book->CancelOrder(msg.order_id);
+    }
+
+    if (mode == QueryMode::NONE || --until_query != 0) continue;
+    until_query = query_every;
+    if (mode == QueryMode::GET_DEPTH) {
+      size_t bid_count = book->GetDepth(Side::BUY, DEPTH_CACHE_LEVELS, bids);
+      size_t ask_count = book->GetDepth(Side::SELL, DEPTH_CACHE_LEVELS, asks);
+      for (size_t i = 0; i < bid_count; ++i) checksum += bids[i].quantity;
+      for (size_t i = 0; i < ask_count; ++i) checksum += asks[i].quantity;
+    } else {
+      const DepthSnapshot &top = book->TopOfBook();
+      for (size_t i = 0; i < top.bid_count; ++i) checksum += top.bids[i].quantity;
+      for (size_t i = 0; i < top.ask_count; ++i) checksum += top.asks[i].quantity;
+    }
+  }
+
+  auto end_time = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      end_time - start_time);
+  std::cout << "V6 " << label << ": " << duration.count() << " ms"
+            << std::endl;
+  delete book;
+  return checksum;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <market_data_file.csv>" << std::endl;
+    return 1;
+  }
+
+  std::vector<Message> messages;
+  if (!LoadMessages(argv[1], messages)) return 1;
+
+  uint64_t checksum = 0;
+  checksum += Run(messages, QueryMode::NONE, 1, "no queries");
+  checksum += Run(messages, QueryMode::GET_DEPTH, 1, "GetDepth every message");
+  checksum += Run(messages, QueryMode::GET_DEPTH, 1000, "GetDepth every 1k");
+  checksum += Run(messages, QueryMode::SNAPSHOT, 1, "snapshot every message");
+  checksum += Run(messages, QueryMode::SNAPSHOT, 1000, "snapshot every 1k");
+  std::cout << "(checksum " << checksum << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,220 @@
+#include "OrderBookV6.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Order expiry in bursts. Time is in microseconds and one message arrives
+// per microsecond. 75% of messages are adds, the rest cancel a random
+// earlier add. Adds are 60% GTD, 30% DAY and 10% GTC; GTD orders live 1 ms
+// to 1 s, rounded up to the next GRID_US boundary the way exchanges batch
+// expiry, so they leave in bursts every 100 ms. The DAY orders still
+// resting all leave at the session close. 5% of adds cross the spread and
+// fill against timed orders. Book time is advanced before every message.
+//
+//   wheel      AddOrder with a time in force; AdvanceTime expires orders
+//              through the book's timer wheel
+//   heap       the same flow with plain GTC orders and an external
+//              std::priority_queue of (expiry, id) popped into CancelOrder,
+//              which is what a client of the book had to do before (its
+//              expired count includes entries of orders already gone)
+//   no expiry  every order GTC and time not advanced, for the add path
+//
+// The wheel and heap books must end in the same state (StateHash); exit
+// status is 1 if they don't or if the wheel book fails VerifyInvariants.
+using Clock = std::chrono::steady_clock;
+
+constexpr Timestamp GRID_US = 100000;
+
+struct TimedMessage {
+  OrderId order_id;
+  Price price;
+  Quantity quantity;
+  char type; // 'A' add, 'C' cancel
+  Side side;
+  TimeInForce tif;
+  Timestamp expire_time; // GTD only
+};
+
+std::vector<TimedMessage> ExpiryMessages(size_t adds) {
+  std::mt19937_64 rng(17);
+  std::uniform_int_distribution<Quantity> quantity(1, 100);
+  std::uniform_int_distribution<Timestamp> lifetime(1000, 1000000);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  std::vector<TimedMessage> messages;
+  std::vector<OrderId> active;
+  messages.reserve(adds * 4 / 3);
+  OrderId order_id = 1;
+  while (order_id <= adds) {
+    const Timestamp now = messages.size();
+    TimedMessage msg{};
+    if (active.empty() || unit(rng) < 0.75) {
+      msg.type = 'A';
+      msg.side = (rng() & 1) ? Side::BUY : Side::SELL;
+      msg.quantity = quantity(rng);
+      msg.order_id = order_id++;
+      double kind = unit(rng);
+      if (kind < 0.05) {
+        // Marketable: a few ticks through the inside.
+        msg.price = msg.side == Side::BUY ? 10001 + rng() % 4 : 9999 - rng() % 4;
+        msg.tif = TimeInForce::GTC;
+      } else {
+        msg.price = msg.side == Side::BUY ? 9999 - rng() % 1000 : 10001 + rng() % 1000;
+        msg.tif = kind < 0.65   ? TimeInForce::GTD
+                  : kind < 0.95 ? TimeInForce::DAY
+                                : TimeInForce::GTC;
+      }
+      if (msg.tif == TimeInForce::GTD) {
+        Timestamp expiry = now + lifetime(rng);
+        msg.expire_time = (expiry + GRID_US - 1) / GRID_US * GRID_US;
+      }
+      active.push_back(msg.order_id);
+    } else {
+      size_t index = rng() % active.size();
+      msg.type = 'C';
+      msg.order_id = active[index];
+      active[index] = active.back();
+      active.pop_back();
+    }
+    messages.push_back(msg);
+  }
+  return messages;
+}
+
+struct ExpiryRun {
+  double total_ms = 0;
+  size_t expired = 0;
+  std::vector<double> burst_us; // AdvanceTime at each grid boundary
+  size_t burst_expired = 0;
+  double close_us = 0;
+  size_t close_expired = 0;
+  uint64_t state_hash = 0;
+  bool verified = true;
+};
+
+enum class Mode { WHEEL, HEAP, NONE };
+
+ExpiryRun Run(const std::vector<TimedMessage> &messages, Timestamp close,
+              Mode mode) {
+  ExpiryRun result;
+  using Entry = std::pair<Timestamp, OrderId>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+  auto *book = new OrderBookV6();
+  book->SetSessionClose(close);
+
+  // Heap mode's AdvanceTime: pop everything due and cancel it; entries of
+  // orders already gone cancel nothing.
+  auto expire_heap = [&](Timestamp now) {
+    size_t expired = 0;
+    while (!heap.empty() && heap.top().first <= now) {
+      book->CancelOrder(heap.top().second);
+      heap.pop();
+      expired++;
+    }
+    return expired;
+  };
+  auto advance = [&](Timestamp now) {
+    return mode == Mode::WHEEL ? book->AdvanceTime(now) : expire_heap(now);
+  };
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < messages.size(); ++i) {
+    const TimedMessage &msg = messages[i];
+    const Timestamp now = i;
+    if (mode != Mode::NONE) {
+      if (now % GRID_US == 0) {
+        auto burst_start = Clock::now();
+        size_t expired = advance(now);
+        result.burst_us.push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - burst_start)
+                .count());
+        result.burst_expired += expired;
+        result.expired += expired;
+      } else {
+        result.expired += advance(now);
+      }
+    }
+    if (msg.type == 'C') {
+      book->CancelOrder(msg.order_id);
+    } else if (mode == Mode::WHEEL) {
+      book->AddOrder(msg.order_id, msg.side, msg.price, msg.quantity, msg.tif,
+                     msg.expire_time);
+    } else {
+      book->AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+      if (mode == Mode::HEAP && msg.tif != TimeInForce::GTC) {
+        heap.push({msg.tif == TimeInForce::DAY ? close : msg.expire_time,
+                   msg.order_id});
+      }
+    }
+  }
+  if (mode != Mode::NONE) {
+    auto close_start = Clock::now();
+    result.close_expired = advance(close);
+    result.close_us =
+        std::chrono::duration<double, std::micro>(Clock::now() - close_start)
+            .count();
+    result.expired += result.close_expired;
+  }
+  result.total_ms =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  result.state_hash = book->StateHash();
+  if (mode == Mode::WHEEL) {
+    std::string error;
+    result.verified = book->VerifyInvariants(&error);
+    if (!result.verified) std::fprintf(stderr, "wheel book: %s\n", error.c_str());
+  }
+  delete book;
+  return result;
+}
+
+void Report(const char *name, ExpiryRun &run, size_t message_count) {
+  double burst_total = 0, burst_max = 0, burst_p50 = 0;
+  if (!run.burst_us.empty()) {
+    std::sort(run.burst_us.begin(), run.burst_us.end());
+    for (double us : run.burst_us) burst_total += us;
+    burst_p50 = run.burst_us[run.burst_us.size() / 2];
+    burst_max = run.burst_us.back();
+  }
+  double per_burst_expired =
+      run.burst_us.empty() ? 0 : double(run.burst_expired) / run.burst_us.size();
+  std::printf("  %-10s %9.1f %8.1f %10zu %9.0f %9.1f %9.1f %10.1f %9.1f %8.1f\n",
+              name, run.total_ms, run.total_ms * 1e6 / message_count,
+              run.expired, per_burst_expired, burst_p50, burst_max,
+              run.burst_expired ? burst_total * 1e3 / run.burst_expired : 0,
+              run.close_us / 1e3,
+              run.close_expired ? run.close_us * 1e3 / run.close_expired : 0);
+}
+
+int main(int argc, char *argv[]) {
+  size_t adds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+  std::vector<TimedMessage> messages = ExpiryMessages(adds);
+  const Timestamp close = (messages.size() / GRID_US + 1) * GRID_US;
+
+  std::printf("V6 expiry: %zu messages (%zu adds) over %.1f s of book time,"
+              " GTD bursts every %llu ms, close at %.1f s\n",
+              messages.size(), adds, messages.size() / 1e6,
+              (unsigned long long)GRID_US / 1000, close / 1e6);
+  std::printf("  %-10s %9s %8s %10s %9s %9s %9s %10s %9s %8s\n", "mode",
+              "total ms", "ns/msg", "expired", "per burst", "burst p50",
+              "burst max", "ns/expired", "close ms", "ns/order");
+  std::printf("  %-10s %9s %8s %10s %9s %9s %9s %10s %9s %8s\n", "", "", "",
+              "", "", "us", "us", "(bursts)", "", "(close)");
+  ExpiryRun none = Run(messages, close, Mode::NONE);
+  ExpiryRun heap = Run(messages, close, Mode::HEAP);
+  ExpiryRun wheel = Run(messages, close, Mode::WHEEL);
+  Report("no expiry", none, messages.size());
+  Report("heap", heap, messages.size());
+  Report("wheel", wheel, messages.size());
+
+  bool ok = wheel.verified && wheel.state_hash == heap.state_hash;
+  std::printf("  final state %s\n",
+              ok ? "matches between wheel and heap" : "DIFFERS");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include "MarketData.h"
+#include "OrderBookV6.h"
+#include "Runtime.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Memory per book for many quiet symbols in one process. Every book
+// replays the same prefix of a market data file, standing in for one
+// low-activity instrument. A first replay records the profile
+// (BasicOrderBookV6::Profile) and the sized runs start each book from
+// BookSizing::FromProfile. Each configuration runs in its own process,
+// and RSS is measured around creating and filling the books; "locked" runs
+// call mlockall(MCL_CURRENT | MCL_FUTURE) first, as --mlock does, which
+// makes every reserved page resident.
+using Clock = std::chrono::steady_clock;
+
+size_t ResidentSetBytes() {
+  FILE *statm = std::fopen("/proc/self/statm", "r");
+  if (!statm) return 0;
+  unsigned long size = 0, resident = 0;
+  if (std::fscanf(statm, "%lu %lu", &size, &resident) != 2) resident = 0;
+  std::fclose(statm);
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+inline void Apply(OrderBookV6 &book, const Message &msg) {
+  if (msg.type == 'A') {
+    book.AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+  } else if (msg.type == 'C') {
+    book.CancelOrder(msg.order_id);
+  }
+}
+
+void RunConfig(const char *name, const BookSizing &sizing, bool lock,
+               size_t book_count, const std::vector<Message> &messages) {
+  std::fflush(stdout);
+  pid_t pid = fork();
+  if (pid == -1) {
+    perror("fork");
+    return;
+  }
+  if (pid > 0) {
+    waitpid(pid, nullptr, 0);
+    return;
+  }
+  if (lock && !LockMemory()) _exit(1);
+  size_t rss_before = ResidentSetBytes();
+  auto start = Clock::now();
+  std::vector<OrderBookV6 *> books;
+  for (size_t b = 0; b < book_count; ++b) {
+    books.push_back(new OrderBookV6(sizing));
+    for (const Message &msg : messages) Apply(*books.back(), msg);
+  }
+  double ms = std::chrono::duration<double, std::milli>(Clock::now() - start)
+                  .count();
+  double per_book = 1.0 / book_count / (1 << 20);
+  size_t reserved = 0, touched = 0;
+  for (const MemoryUse &use : books[0]->MemoryReport()) {
+    reserved += use.reserved;
+    touched += use.touched;
+  }
+  std::printf("  %-16s %6zu %12.1f %12.2f %12.2f %10.1f\n", name, book_count,
+              reserved / double(1 << 20), touched / double(1 << 20),
+              (ResidentSetBytes() - rss_before) * per_book, ms / book_count);
+  std::fflush(stdout);
+  _exit(0);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr,
+                 "usage: %s <market_data_file.csv> [books] [messages_per_book]"
+                 " [locked_books]\n",
+                 argv[0]);
+    return 1;
+  }
+  size_t book_count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+  size_t per_book = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 20000;
+  size_t locked_count = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 4;
+  std::vector<Message> messages;
+  if (!LoadMessages(argv[1], messages)) return 1;
+  if (messages.size() > per_book) messages.resize(per_book);
+
+  BookProfile profile;
+  {
+    auto *book = new OrderBookV6();
+    for (const Message &msg : messages) Apply(*book, msg);
+    profile = book->Profile();
+    delete book;
+  }
+  BookSizing sized = BookSizing::FromProfile(profile);
+  std::printf("V6 footprint: %zu messages per book; profile: peak %zu resting"
+              " orders, max id %llu -> %zu slots, ids < %llu\n",
+              messages.size(), profile.peak_resting_orders,
+              (unsigned long long)profile.max_order_id, sized.resting_orders,
+              (unsigned long long)sized.order_id_limit);
+  std::printf("  %-16s %6s %12s %12s %12s %10s\n", "config", "books",
+              "reserved MB", "touched MB", "RSS MB/book", "ms/book");
+  RunConfig("default", OrderBookV6::DefaultSizing(), false, book_count,
+            messages);
+  RunConfig("sized", sized, false, book_count, messages);
+  RunConfig("default, locked", OrderBookV6::DefaultSizing(), true,
+            locked_count, messages);
+  RunConfig("sized, locked", sized, true, locked_count, messages);
+  return 0;
+}
@@ -0,0 +1,334 @@
+#include "Gateway.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+
+// Round-trip latency through the coroutine gateway (Gateway.h) against the
+// number of connected clients, 10 to 10k by default. The clients run in a
+// forked process over a Unix-domain socket, each in a closed loop: send an
+// order, wait for its ack, send the next. Requests are ~70% adds around
+// one price, ~30% cancels of the client's own earlier adds and 1% over the
+// quantity limit (rejected by the session's risk check). Latency is
+// measured in the client process, from the write to the ack being read.
+using Clock = std::chrono::steady_clock;
+
+struct ClientReport {
+  uint64_t messages;
+  uint64_t rejected;
+  int64_t elapsed_ns;
+  int64_t p50_ns, p99_ns, p999_ns, max_ns;
+  bool ok;
+};
+
+inline int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+inline uint64_t NextRandom(uint64_t &state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+struct Client {
+  int fd;
+  uint64_t random;
+  size_t remaining;
+  int64_t sent_ns;
+  OrderId own_ids[16]; // recent accepted adds, to cancel
+  unsigned own_count = 0;
+  OrderAck ack;
+  size_t ack_bytes = 0;
+};
+
+bool SendNext(Client &client, uint64_t tag, const RiskLimits &limits) {
+  uint64_t r = NextRandom(client.random);
+  OrderRequest request{};
+  request.client_tag = tag;
+  if (r % 100 < 30 && client.own_count > 0) {
+    request.type = 'C';
+    request.order_id = client.own_ids[--client.own_count];
+  } else {
+    request.type = 'A';
+    request.side = (r >> 8) & 1 ? Side::BUY : Side::SELL;
+    request.price = 10000 + (r >> 16) % 21 - 10;
+    request.quantity = (r >> 32) % 100 == 0 ? limits.max_quantity + 1
+                                            : 1 + (r >> 40) % 100;
+  }
+  client.sent_ns = NowNs();
+  return write(client.fd, &request, sizeof request) == sizeof request;
+}
+
+// Client process: connects, waits for `go`, runs the closed loops.
+ClientReport RunClients(const char *path, size_t count, size_t per_client,
+                        int go_fd, const RiskLimits &limits) {
+  ClientReport report{};
+  std::vector<Client> clients(count);
+  int epoll_fd = epoll_create1(0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  for (size_t c = 0; c < count; ++c) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1 || connect(fd, (sockaddr *)&address, sizeof address) == -1) {
+      perror("client connect");
+      return report;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    clients[c].fd = fd;
+    clients[c].random = 0x9E3779B97F4A7C15ULL * (c + 1);
+    clients[c].remaining = per_client;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = c;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+  }
+  char go;
+  if (read(go_fd, &go, 1) != 1) return report;
+
+  std::vector<int64_t> latency_ns;
+  latency_ns.reserve(count * per_client);
+  auto start = NowNs();
+  size_t active = count;
+  for (size_t c = 0; c < count; ++c) {
+    if (!SendNext(clients[c], c, limits)) return report;
+  }
+  epoll_event events[256];
+  while (active > 0) {
+    int ready = epoll_wait(epoll_fd, events, 256, 1000);
+    if (ready <= 0) {
+      std::fprintf(stderr, "clients: no acks for 1s\n");
+      return report;
+    }
+    for (int i = 0; i < ready; ++i) {
+      Client &client = clients[events[i].data.u64];
+      ssize_t n = read(client.fd, reinterpret_cast<char *>(&client.ack) +
+                                      client.ack_bytes,
+                       sizeof(OrderAck) - client.ack_bytes);
+      if (n <= 0) {
+        if (n < 0 && errno == EAGAIN) continue;
+        std::fprintf(stderr, "clients: gateway closed a session\n");
+        return report;
+      }
+      client.ack_bytes += n;
+      if (client.ack_bytes < sizeof(OrderAck)) continue;
+      client.ack_bytes = 0;
+      latency_ns.push_back(NowNs() - client.sent_ns);
+      if (client.ack.status == AckStatus::REJECTED) {
+        ++report.rejected;
+      } else if (client.ack.order_id != 0 && client.own_count < 16) {
+        client.own_ids[client.own_count++] = client.ack.order_id;
+      }
+      if (--client.remaining == 0) {
+        --active;
+      } else if (!SendNext(client, events[i].data.u64, limits)) {
+        return report;
+      }
+    }
+  }
+  report.elapsed_ns = NowNs() - start;
+  for (Client &client : clients) close(client.fd);
+  close(epoll_fd);
+
+  std::sort(latency_ns.begin(), latency_ns.end());
+  report.messages = latency_ns.size();
+  report.p50_ns = latency_ns[latency_ns.size() / 2];
+  report.p99_ns = latency_ns[latency_ns.size() * 99 / 100];
+  report.p999_ns = latency_ns[latency_ns.size() * 999 / 1000];
+  report.max_ns = latency_ns.back();
+  report.ok = true;
+  return report;
+}
+
+// One request and its ack over a blocking client socket.
+bool RoundTrip(int fd, const OrderRequest &request, OrderAck &ack) {
+  return write(fd, &request, sizeof request) == sizeof request &&
+         read(fd, &ack, sizeof ack) == sizeof ack;
+}
+
+// Two sessions on one reactor: the second may not cancel the first's
+// order, and the first still can.
+bool ForeignCancelsRejected() {
+  int pairs[2][2];
+  for (auto &pair : pairs) {
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) == -1) {
+      perror("socketpair");
+      return false;
+    }
+    fcntl(pair[1], F_SETFL, O_NONBLOCK);
+  }
+  GatewayReactor reactor;
+  if (!reactor.Ok()) return false;
+  GatewayMatcher matcher({&reactor});
+  RiskLimits limits;
+  for (auto &pair : pairs) RunSession(*reactor.Add(pair[1]), matcher, limits);
+  matcher.Start();
+  std::thread thread([&reactor]() { reactor.Run(); });
+
+  OrderRequest add{1, 0, 10000, 10, 'A', Side::BUY};
+  OrderAck added{}, foreign{}, own{};
+  bool ok = RoundTrip(pairs[0][0], add, added) &&
+            added.status == AckStatus::ACCEPTED;
+  OrderRequest cancel{2, added.order_id, 0, 0, 'C', Side::BUY};
+  ok = ok && RoundTrip(pairs[1][0], cancel, foreign) &&
+       foreign.status == AckStatus::REJECTED &&
+       RoundTrip(pairs[0][0], cancel, own) &&
+       own.status == AckStatus::ACCEPTED;
+  for (auto &pair : pairs) close(pair[0]);
+  thread.join();
+  matcher.Stop();
+  return ok;
+}
+
+// Server side of one run: accept `count` connections, serve them on
+// `reactor_count` reactor threads plus the matcher, collect the report.
+bool RunOnce(int listen_fd, const char *path, size_t count, size_t per_client,
+             unsigned reactor_count, const RiskLimits &limits,
+             ClientReport &report) {
+  int go_pipe[2], report_pipe[2];
+  if (pipe(go_pipe) == -1 || pipe(report_pipe) == -1) {
+    perror("pipe");
+    return false;
+  }
+  pid_t pid = fork();
+  if (pid == -1) {
+    perror("fork");
+    return false;
+  }
+  if (pid == 0) {
+    close(listen_fd);
+    close(go_pipe[1]);
+    close(report_pipe[0]);
+    ClientReport result = RunClients(path, count, per_client, go_pipe[0], limits);
+    if (write(report_pipe[1], &result, sizeof result) != sizeof result) _exit(1);
+    _exit(0);
+  }
+  close(go_pipe[0]);
+  close(report_pipe[1]);
+
+  std::vector<std::unique_ptr<GatewayReactor>> reactors;
+  std::vector<GatewayReactor *> reactor_ptrs;
+  for (unsigned r = 0; r < reactor_count; ++r) {
+    reactors.push_back(std::make_unique<GatewayReactor>());
+    if (!reactors.back()->Ok()) return false;
+    reactor_ptrs.push_back(reactors.back().get());
+  }
+  auto matcher = std::make_unique<GatewayMatcher>(reactor_ptrs);
+  bool ok = true;
+  for (size_t c = 0; c < count && ok; ++c) {
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    Session *session =
+        fd == -1 ? nullptr : reactors[c % reactor_count]->Add(fd);
+    if (!session) {
+      perror("accept");
+      ok = false;
+      break;
+    }
+    RunSession(*session, *matcher, limits);
+  }
+
+  matcher->Start();
+  std::vector<std::thread> threads;
+  for (auto &reactor : reactors) {
+    threads.emplace_back([&reactor]() { reactor->Run(); });
+  }
+  char go = 'g';
+  if (ok && write(go_pipe[1], &go, 1) != 1) ok = false;
+  close(go_pipe[1]);
+  ok = ok && read(report_pipe[0], &report, sizeof report) == sizeof report;
+  close(report_pipe[0]);
+  for (std::thread &thread : threads) thread.join();
+  matcher->Stop();
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return ok && report.ok && matcher->Processed() + report.rejected >=
+                                report.messages;
+}
+
+int main(int argc, char *argv[]) {
+  size_t messages = 200000;
+  unsigned reactor_count = 1;
+  size_t max_clients = 10000;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--messages" && i + 1 < argc) {
+      messages = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--reactors" && i + 1 < argc) {
+      reactor_count = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--max-clients" && i + 1 < argc) {
+      max_clients = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--messages N] [--reactors N] [--max-clients N]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  // Each process holds one socket per client; take the whole fd allowance.
+  rlimit files;
+  getrlimit(RLIMIT_NOFILE, &files);
+  files.rlim_cur = files.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &files);
+  size_t fd_cap = files.rlim_cur > 64 ? files.rlim_cur - 64 : 0;
+  if (max_clients > fd_cap) {
+    std::fprintf(stderr, "clients capped at %zu by the fd limit\n", fd_cap);
+    max_clients = fd_cap;
+  }
+
+  std::string path = "/tmp/bench_gateway_v6." + std::to_string(getpid());
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  if (listen_fd == -1 ||
+      bind(listen_fd, (sockaddr *)&address, sizeof address) == -1 ||
+      listen(listen_fd, 4096) == -1) {
+    perror("listen");
+    return 1;
+  }
+
+  if (!ForeignCancelsRejected()) {
+    std::fprintf(stderr, "a session cancelled another session's order\n");
+    return 1;
+  }
+
+  RiskLimits limits;
+  std::printf("V6 gateway: %zu requests per run, %u reactor thread(s) + 1"
+              " matcher, %ld online cpus\n",
+              messages, reactor_count, sysconf(_SC_NPROCESSORS_ONLN));
+  std::printf("  %8s %10s %10s %10s %10s %10s %10s %9s\n", "clients", "ms",
+              "k msgs/s", "p50 us", "p99 us", "p99.9 us", "max us",
+              "rejected");
+  bool all_ok = true;
+  for (size_t count = 10; count <= max_clients; count *= 10) {
+    size_t per_client = std::max<size_t>(messages / count, 10);
+    ClientReport report{};
+    bool ok = RunOnce(listen_fd, path.c_str(), count, per_client,
+                      reactor_count, limits, report);
+    all_ok &= ok;
+    if (!ok) {
+      std::printf("  %8zu failed\n", count);
+      continue;
+    }
+    double ms = report.elapsed_ns / 1e6;
+    std::printf("  %8zu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %9llu\n",
+                count, ms, report.messages / ms, report.p50_ns / 1e3,
+                report.p99_ns / 1e3, report.p999_ns / 1e3, report.max_ns / 1e3,
+                (unsigned long long)report.rejected);
+  }
+  close(listen_fd);
+  unlink(path.c_str());
+  return all_ok ? 0 : 1;
+}
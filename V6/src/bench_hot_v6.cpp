@@ -0,0 +1,91 @@
+#include "MarketData.h"
+#include "OrderBookV6.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+// Inside-of-book benchmark for the hot level window, run with the window
+// off and on. The synthetic stream keeps almost all activity within a few
+// ticks of a slowly drifting mid: passive adds at the touch, marketable adds
+// that fill one or two levels, and cancels of recently added orders. An
+// optional market data file is replayed the same way.
+constexpr size_t SYNTHETIC_MESSAGES = 2000000;
+constexpr Price SYNTHETIC_MID = 10000;
+
+std::vector<Message> InsideHeavyMessages(size_t count) {
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int> offset(-1, 3);
+  std::uniform_int_distribution<Quantity> quantity(1, 100);
+  std::uniform_int_distribution<int> percent(0, 99);
+
+  std::vector<Message> messages;
+  std::vector<OrderId> live;
+  messages.reserve(count);
+  Price mid = SYNTHETIC_MID;
+  OrderId order_id = 1;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (i % 1000 == 0) mid += (percent(rng) < 50) ? 1 : -1;
+    Message msg{};
+    if (!live.empty() && percent(rng) < 45) {
+      // Cancel one of the last few hundred orders, most of which still rest.
+      size_t window = std::min<size_t>(live.size(), 256);
+      size_t index = live.size() - 1 - (rng() % window);
+      msg.type = 'C';
+      msg.order_id = live[index];
+      live[index] = live.back();
+      live.pop_back();
+    } else {
+      msg.type = 'A';
+      msg.side = (percent(rng) < 50) ? Side::BUY : Side::SELL;
+      // Offset -1 crosses the spread, 0..3 joins or sits just behind it.
+      int ticks = offset(rng);
+      msg.price = (msg.side == Side::BUY) ? mid - ticks : mid + 1 + ticks;
+      msg.quantity = quantity(rng);
+      msg.order_id = order_id++;
+      live.push_back(msg.order_id);
+    }
+    messages.push_back(msg);
+  }
+  return messages;
+}
+
+void Run(const std::vector<Message> &messages, bool hot_levels,
+         const std::string &label) {
+  auto *book = new OrderBookV6();
+  if (hot_levels) book->EnableHotLevels();
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+
+  for (const Message &msg : messages) {
+    if (msg.type == 'A') {
+      book->AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+    } else if (msg.type == 'C') {
+      book->CancelOrder(msg.order_id);
+    }
+  }
+
+  auto end_time = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      end_time - start_time);
+  std::cout << "V6 " << label << ": " << duration.count() << " ms ("
+            << messages.size() << " messages)" << std::endl;
+  delete book;
+}
+
+void RunBoth(const std::vector<Message> &messages, const std::string &name) {
+  Run(messages, false, name + ", array only");
+  Run(messages, true, name + ", hot window");
+}
+
+int main(int argc, char *argv[]) {
+  RunBoth(InsideHeavyMessages(SYNTHETIC_MESSAGES), "inside-heavy synthetic");
+
+  if (argc > 1) {
+    std::vector<Message> messages;
+    if (!LoadMessages(argv[1], messages)) return 1;
+    RunBoth(messages, argv[1]);
+  }
+  return 0;
+}
@@ -0,0 +1,233 @@
+#include "IngestPipeline.h"
+#include "OrderBookV6.h"
+#include "Runtime.h"
+#include "StreamReader.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+// End-to-end throughput (parse + match) of a market data file against the
+// number of parser threads. "inline" parses each line and applies it on
+// the matching thread, as orderbook_v6 does; N >= 1 runs ParallelIngest
+// with N workers feeding the matching thread. The file is mapped and
+// prefaulted before timing, and each run checks that the book ends in the
+// same state as the inline run.
+//
+// The streaming readers (StreamReader.h) are then checked against the
+// mapped file: the first READER_CHECK_BYTES of it, cut after an add, are
+// written out twice, as is and without the final newline, and both
+// readers must parse exactly the messages the mapped copy does. Exit
+// status is 1 if a reader disagrees or a run ends in a different state.
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t CHECK_LEVELS = 5;
+constexpr size_t READER_CHECK_BYTES = size_t(1) << 20;
+
+struct BookState {
+  Price last_trade;
+  DepthLevel bids[CHECK_LEVELS];
+  DepthLevel asks[CHECK_LEVELS];
+  size_t bid_count, ask_count;
+
+  bool operator==(const BookState &other) const {
+    if (last_trade != other.last_trade || bid_count != other.bid_count ||
+        ask_count != other.ask_count) {
+      return false;
+    }
+    for (size_t i = 0; i < bid_count; ++i) {
+      if (bids[i].price != other.bids[i].price ||
+          bids[i].quantity != other.bids[i].quantity) {
+        return false;
+      }
+    }
+    for (size_t i = 0; i < ask_count; ++i) {
+      if (asks[i].price != other.asks[i].price ||
+          asks[i].quantity != other.asks[i].quantity) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+BookState StateOf(const OrderBookV6 &book) {
+  BookState state;
+  state.last_trade = book.LastTradePrice();
+  state.bid_count = book.GetDepth(Side::BUY, CHECK_LEVELS, state.bids);
+  state.ask_count = book.GetDepth(Side::SELL, CHECK_LEVELS, state.asks);
+  return state;
+}
+
+inline void Apply(OrderBookV6 &book, const Message &msg) {
+  if (msg.type == 'A') {
+    book.AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+  } else if (msg.type == 'C') {
+    book.CancelOrder(msg.order_id);
+  }
+}
+
+// threads == 0: parse and apply line by line on this thread.
+double Run(const char *data, size_t size, unsigned threads, int avoid_cpu,
+           size_t &messages, BookState &state) {
+  auto *book = new OrderBookV6();
+  auto start = Clock::now();
+  messages = 0;
+  if (threads == 0) {
+    const char *ptr = data;
+    const char *end = data + size;
+    Message msg;
+    while (ptr < end) {
+      ParseMessage(ptr, end, msg);
+      Apply(*book, msg);
+      ++messages;
+    }
+  } else {
+    ParallelIngest ingest(data, size, threads, avoid_cpu);
+    messages = ingest.Drain([&](const Message &msg) { Apply(*book, msg); });
+  }
+  double ms = std::chrono::duration<double, std::milli>(Clock::now() - start)
+                  .count();
+  state = StateOf(*book);
+  delete book;
+  return ms;
+}
+
+struct ParseDigest {
+  size_t messages = 0;
+  uint64_t hash = 14695981039346656037ULL;
+
+  void Add(const char *ptr, const char *end) {
+    Message msg;
+    while (ptr < end) {
+      ParseMessage(ptr, end, msg);
+      for (uint64_t field : {uint64_t(msg.type), uint64_t(msg.side),
+                             uint64_t(msg.order_id), uint64_t(msg.price),
+                             uint64_t(msg.quantity)}) {
+        hash = (hash ^ field) * 1099511628211ULL;
+      }
+      ++messages;
+    }
+  }
+  bool operator==(const ParseDigest &other) const {
+    return messages == other.messages && hash == other.hash;
+  }
+};
+
+template <typename Reader> ParseDigest ReadAll(Reader &reader) {
+  ParseDigest digest;
+  const char *begin, *end;
+  while (reader.Next(begin, end)) digest.Add(begin, end);
+  return digest;
+}
+
+// Both readers at their smallest windows, so many lines cross a boundary.
+bool ReadersAgree(const std::string &text, const char *label) {
+  char path[] = "/tmp/bench_ingest_v6_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd == -1) {
+    perror("mkstemp");
+    return false;
+  }
+  unlink(path);
+  if (write(fd, text.data(), text.size()) != ssize_t(text.size())) {
+    perror("write");
+    close(fd);
+    return false;
+  }
+  ParseDigest mapped;
+  mapped.Add(text.c_str(), text.c_str() + text.size());
+  MmapStreamReader mmap_reader(fd, 0);
+  ParseDigest streamed = ReadAll(mmap_reader);
+  // What follows the last line in a uring buffer is left over from an
+  // earlier read; shifting the buffer size moves that to every offset
+  // within a line, digits included.
+  bool uring_available = true, uring_ok = true;
+  for (size_t shift = 0; shift < 32 && uring_available; ++shift) {
+    UringStreamReader uring_reader(fd, MAX_LINE + shift);
+    uring_available = uring_reader.Ok();
+    if (uring_available) uring_ok &= ReadAll(uring_reader) == mapped;
+  }
+  close(fd);
+  std::printf("  readers, %s: %zu messages, mmap %s, uring %s\n", label,
+              mapped.messages, streamed == mapped ? "ok" : "DIFF",
+              !uring_available ? "unavailable" : uring_ok ? "ok" : "DIFF");
+  return streamed == mapped && uring_ok;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s <market_data_file.csv> [max_threads]\n",
+                 argv[0]);
+    return 1;
+  }
+  unsigned hardware = std::thread::hardware_concurrency();
+  unsigned max_threads = argc > 2 ? std::atoi(argv[2]) : hardware;
+  if (max_threads == 0) max_threads = 1;
+
+  int fd = open(argv[1], O_RDONLY);
+  if (fd == -1) {
+    perror("open");
+    return 1;
+  }
+  struct stat sb;
+  if (fstat(fd, &sb) == -1) {
+    perror("fstat");
+    close(fd);
+    return 1;
+  }
+  size_t size = sb.st_size;
+  const char *data = static_cast<const char *>(
+      mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0));
+  close(fd);
+  if (data == MAP_FAILED) {
+    perror("mmap");
+    return 1;
+  }
+  PrefaultRead(data, size);
+
+  // The matcher stays on the calling thread; pin it to the last CPU and
+  // keep the parsers off it when there are CPUs to spare.
+  int matcher_cpu = hardware > 1 ? PickMatcherCpu() : -1;
+  if (matcher_cpu >= 0) PinThread(pthread_self(), matcher_cpu);
+
+  std::printf("V6 ingest of %s, %u hardware threads (best of 3)\n", argv[1],
+              hardware);
+  std::printf("  %-8s %10s %12s %8s\n", "parsers", "ms", "M msgs/s", "state");
+  BookState reference;
+  bool same_state = true;
+  for (unsigned threads = 0; threads <= max_threads;
+       threads = threads ? threads * 2 : 1) {
+    double best = 0;
+    size_t messages = 0;
+    BookState state;
+    for (int r = 0; r < 3; ++r) {
+      double ms = Run(data, size, threads, matcher_cpu, messages, state);
+      if (r == 0 || ms < best) best = ms;
+    }
+    if (threads == 0) reference = state;
+    char label[16];
+    std::snprintf(label, sizeof(label), threads ? "%u" : "inline", threads);
+    std::printf("  %-8s %10.1f %12.2f %8s\n", label, best,
+                messages / best / 1000.0, state == reference ? "ok" : "DIFF");
+    same_state &= state == reference;
+  }
+
+  // Ended on an add, whose last field is the one an unterminated line
+  // leaves open to whatever follows it.
+  size_t prefix = std::min(size, READER_CHECK_BYTES);
+  while (prefix > 0) {
+    while (prefix > 0 && data[prefix - 1] != '\n') --prefix;
+    size_t line = prefix > 0 ? prefix - 1 : 0;
+    while (line > 0 && data[line - 1] != '\n') --line;
+    if (prefix == 0 || data[line] == 'A') break;
+    prefix = line;
+  }
+  std::string text(data, prefix);
+  bool readers_ok = ReadersAgree(text, "newline at end");
+  if (!text.empty()) text.pop_back();
+  readers_ok &= ReadersAgree(text, "no newline at end");
+  munmap((void *)data, size);
+  return same_state && readers_ok ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+#include "OrderBookV6.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Level-allocation benchmark: for each queue depth, rest `depth` sell orders
+// of 100 at one price, then time ten buy aggressors that each take 5% of the
+// level. Repeated over enough rounds that every depth touches roughly the
+// same number of resting orders.
+template <typename Book>
+void RunDepth(const char *policy_name, OrderId depth) {
+  constexpr Price LEVEL_PRICE = 10000;
+  constexpr Quantity ORDER_QTY = 100;
+  constexpr int AGGRESSORS_PER_ROUND = 10;
+  const OrderId rounds = std::max<OrderId>(1, 200000 / depth);
+  const Quantity aggressor_qty = static_cast<Quantity>(depth * ORDER_QTY / 20);
+
+  auto *book = new Book();
+  OrderId order_id = 1;
+  std::chrono::nanoseconds match_time{0};
+
+  for (OrderId round = 0; round < rounds; ++round) {
+    OrderId first_resting = order_id;
+    for (OrderId i = 0; i < depth; ++i) {
+      book->AddOrder(order_id++, Side::SELL, LEVEL_PRICE, ORDER_QTY);
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < AGGRESSORS_PER_ROUND; ++i) {
+      book->AddOrder(order_id++, Side::BUY, LEVEL_PRICE, aggressor_qty);
+    }
+    match_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    for (OrderId id = first_resting; id < first_resting + depth; ++id) {
+      book->CancelOrder(id);
+    }
+  }
+
+  double ns_per_aggressor =
+      static_cast<double>(match_time.count()) /
+      static_cast<double>(rounds * AGGRESSORS_PER_ROUND);
+  std::cout << "V6 " << policy_name << " depth " << depth << ": "
+            << ns_per_aggressor << " ns/aggressor" << std::endl;
+  delete book;
+}
+
+int main() {
+  const OrderId depths[] = {10, 100, 1000, 10000};
+  for (OrderId depth : depths) {
+    RunDepth<OrderBookV6>("FIFO", depth);
+    RunDepth<OrderBookV6ProRata>("ProRata", depth);
+    RunDepth<OrderBookV6FifoProRata>("FifoProRata", depth);
+  }
+  return 0;
+}
@@ -0,0 +1,352 @@
+#include "OrderBookV6.h"
+#include "Replication.h"
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Primary/replica replication of a market data file (Replication.h). Each
+// run forks the processes it needs; all of them share the parsed input.
+//
+//   standalone  one book, no replication: the rate to compare against
+//   pipelined   the primary streams as fast as the ring allows and releases
+//               client acks as the replica confirms them; the latency is
+//               publish -> ack release, sampled every 64th message
+//   sync        one message in flight: publish, apply, wait for the ack
+//   idle        the primary publishes half of the sync prefix, goes quiet
+//               for three timeouts calling only Beat(), then publishes the
+//               rest; the replica must not take it for lost
+//   failover    the primary is SIGKILLed after --kill-at messages; the
+//               replica detects the loss, takes over from its last applied
+//               sequence and finishes the input
+//
+// Every replicated run checks the replica's state hash against the
+// primary's at each ack, and the final state against the standalone run.
+// Exit status is 1 if anything diverged.
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t LATENCY_SAMPLE = 64;
+
+inline void Apply(OrderBookV6 &book, const Message &msg) {
+  if (msg.type == 'A') {
+    book.AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+  } else if (msg.type == 'C') {
+    book.CancelOrder(msg.order_id);
+  }
+}
+
+struct LatencySummary {
+  size_t samples = 0;
+  int64_t p50 = 0, p99 = 0, max = 0;
+};
+
+LatencySummary Summarize(std::vector<int64_t> &ns) {
+  LatencySummary summary;
+  if (ns.empty()) return summary;
+  std::sort(ns.begin(), ns.end());
+  summary.samples = ns.size();
+  summary.p50 = ns[ns.size() / 2];
+  summary.p99 = ns[ns.size() * 99 / 100];
+  summary.max = ns.back();
+  return summary;
+}
+
+struct PrimaryStats {
+  double ms = 0;
+  uint64_t final_hash = 0;
+  size_t hash_mismatches = 0;
+  bool replica_lost = false;
+  std::vector<int64_t> latency_ns;
+};
+
+// Primary side of the pipelined run: publish, apply, and release acks as
+// the replica confirms them.
+void RunPrimary(ReplicationChannel &channel, const std::vector<Message> &messages,
+                int64_t timeout_ns, PrimaryStats &stats) {
+  auto *book = new OrderBookV6();
+  book->EnableStateHash();
+  ReplicationPrimary primary(channel, timeout_ns);
+  std::vector<uint64_t> own_hash(ReplicationChannel::CAPACITY);
+  std::vector<int64_t> publish_ns(ReplicationChannel::CAPACITY);
+  const uint64_t mask = ReplicationChannel::CAPACITY - 1;
+  stats.latency_ns.reserve(messages.size() / LATENCY_SAMPLE + 1);
+  uint64_t released = 0;
+
+  auto release = [&](uint64_t acked) {
+    if (acked <= released) return;
+    int64_t now = ReplicationClockNs();
+    for (uint64_t s = (released / LATENCY_SAMPLE + 1) * LATENCY_SAMPLE;
+         s <= acked; s += LATENCY_SAMPLE) {
+      stats.latency_ns.push_back(now - publish_ns[s & mask]);
+    }
+    if (primary.ReplicaHash(acked) != own_hash[acked & mask]) {
+      ++stats.hash_mismatches;
+    }
+    released = acked;
+  };
+
+  auto start = Clock::now();
+  for (const Message &msg : messages) {
+    uint64_t sequence = primary.Publish(msg);
+    if (sequence == 0) {
+      stats.replica_lost = true;
+      break;
+    }
+    if (sequence % LATENCY_SAMPLE == 0) {
+      publish_ns[sequence & mask] = ReplicationClockNs();
+    }
+    Apply(*book, msg);
+    own_hash[sequence & mask] = book->StateHash();
+    release(primary.Acked());
+  }
+  if (!stats.replica_lost && !primary.Finish()) stats.replica_lost = true;
+  release(primary.Acked());
+  stats.ms = std::chrono::duration<double, std::milli>(Clock::now() - start)
+                 .count();
+  stats.final_hash = book->StateHash();
+  delete book;
+}
+
+// Forks the replica. It follows the primary; if the primary is lost and
+// `promote` is set it takes over, applying the rest of the input from its
+// last applied sequence (the clients resend everything not acked, and the
+// sequence numbers drop the duplicates).
+pid_t StartReplica(ReplicationChannel &channel,
+                   const std::vector<Message> &messages, int64_t timeout_ns,
+                   bool promote) {
+  pid_t pid = fork();
+  if (pid != 0) {
+    if (pid == -1) perror("fork");
+    return pid;
+  }
+  auto *book = new OrderBookV6();
+  book->EnableStateHash();
+  FollowResult result = FollowPrimary(channel, *book, timeout_ns, Apply);
+  if (result == FollowResult::PRIMARY_LOST) {
+    if (!promote) _exit(2);
+    uint64_t applied = channel.applied.load(std::memory_order_relaxed);
+    double silent_ms =
+        (ReplicationClockNs() -
+         channel.primary_heartbeat.load(std::memory_order_relaxed)) /
+        1e6;
+    std::printf("  replica: primary lost after sequence %llu, promoted"
+                " %.1f ms after its last heartbeat\n",
+                (unsigned long long)applied, silent_ms);
+    std::fflush(stdout);
+    for (uint64_t s = applied; s < messages.size(); ++s) {
+      Apply(*book, messages[s]);
+    }
+    channel.final_hash.store(book->StateHash(), std::memory_order_relaxed);
+  }
+  _exit(0);
+}
+
+bool WaitExited(pid_t pid, const char *who) {
+  int status = 0;
+  if (waitpid(pid, &status, 0) == -1) {
+    perror("waitpid");
+    return false;
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    std::fprintf(stderr, "%s exited abnormally (status %d)\n", who, status);
+    return false;
+  }
+  return true;
+}
+
+void PrintRun(const char *name, size_t messages, double ms,
+              const LatencySummary &latency, const char *state) {
+  std::printf("  %-11s %10.1f %10.2f %10lld %10lld %10lld %7s\n", name, ms,
+              messages / ms / 1000.0, (long long)latency.p50,
+              (long long)latency.p99, (long long)latency.max, state);
+}
+
+int main(int argc, char *argv[]) {
+  const char *filename = nullptr;
+  int64_t timeout_ms = 200;
+  size_t sync_messages = 200000;
+  size_t kill_at = 0; // 0: half the input
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--timeout" && i + 1 < argc) {
+      timeout_ms = std::atoll(argv[++i]);
+    } else if (arg == "--sync" && i + 1 < argc) {
+      sync_messages = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--kill-at" && i + 1 < argc) {
+      kill_at = std::strtoull(argv[++i], nullptr, 10);
+    } else if (!filename && arg[0] != '-') {
+      filename = argv[i];
+    } else {
+      filename = nullptr;
+      break;
+    }
+  }
+  if (!filename) {
+    std::fprintf(stderr,
+                 "usage: %s [--timeout MS] [--sync N] [--kill-at N]"
+                 " <market_data_file.csv>\n",
+                 argv[0]);
+    return 1;
+  }
+  std::vector<Message> messages;
+  if (!LoadMessages(filename, messages) || messages.empty()) return 1;
+  const int64_t timeout_ns = timeout_ms * 1000000;
+  if (kill_at == 0 || kill_at >= messages.size()) kill_at = messages.size() / 2;
+  sync_messages = std::min(sync_messages, messages.size());
+  bool ok = true;
+
+  std::printf("V6 replication of %s: %zu messages, ring of %zu, ack every"
+              " <= %zu, %ld online cpus\n",
+              filename, messages.size(), ReplicationChannel::CAPACITY,
+              ReplicationChannel::ACK_BATCH, sysconf(_SC_NPROCESSORS_ONLN));
+  std::printf("  %-11s %10s %10s %10s %10s %10s %7s\n", "run", "ms",
+              "M msgs/s", "p50 ns", "p99 ns", "max ns", "state");
+
+  // Standalone, with the state hash on as in the replicated runs.
+  uint64_t reference_hash;
+  {
+    auto *book = new OrderBookV6();
+    book->EnableStateHash();
+    auto start = Clock::now();
+    for (const Message &msg : messages) Apply(*book, msg);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start)
+                    .count();
+    reference_hash = book->StateHash();
+    delete book;
+    PrintRun("standalone", messages.size(), ms, LatencySummary(), "-");
+  }
+
+  // Pipelined.
+  {
+    ReplicationChannel *channel = ReplicationChannel::Create();
+    if (!channel) return 1;
+    pid_t replica = StartReplica(*channel, messages, timeout_ns, false);
+    if (replica == -1) return 1;
+    PrimaryStats stats;
+    RunPrimary(*channel, messages, timeout_ns, stats);
+    bool exited = WaitExited(replica, "replica");
+    bool same = exited && !stats.replica_lost && stats.hash_mismatches == 0 &&
+                stats.final_hash == reference_hash &&
+                channel->final_hash.load() == reference_hash;
+    ok &= same;
+    PrintRun("pipelined", messages.size(), stats.ms,
+             Summarize(stats.latency_ns), same ? "ok" : "DIFF");
+    ReplicationChannel::Destroy(channel);
+  }
+
+  // Sync: every message waits for its ack before the next is published.
+  {
+    ReplicationChannel *channel = ReplicationChannel::Create();
+    if (!channel) return 1;
+    std::vector<Message> prefix(messages.begin(),
+                                messages.begin() + sync_messages);
+    pid_t replica = StartReplica(*channel, prefix, timeout_ns, false);
+    if (replica == -1) return 1;
+    auto *book = new OrderBookV6();
+    book->EnableStateHash();
+    ReplicationPrimary primary(*channel, timeout_ns);
+    std::vector<int64_t> latency_ns;
+    latency_ns.reserve(prefix.size());
+    size_t mismatches = 0;
+    bool lost = false;
+    auto start = Clock::now();
+    for (const Message &msg : prefix) {
+      int64_t publish_ns = ReplicationClockNs();
+      uint64_t sequence = primary.Publish(msg);
+      Apply(*book, msg);
+      if (sequence == 0 || !primary.WaitForAck(sequence)) {
+        lost = true;
+        break;
+      }
+      latency_ns.push_back(ReplicationClockNs() - publish_ns);
+      if (primary.ReplicaHash(sequence) != book->StateHash()) ++mismatches;
+    }
+    if (!lost) lost = !primary.Finish();
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start)
+                    .count();
+    delete book;
+    bool exited = WaitExited(replica, "replica");
+    bool same = exited && !lost && mismatches == 0;
+    ok &= same;
+    PrintRun("sync", prefix.size(), ms, Summarize(latency_ns),
+             same ? "ok" : "DIFF");
+    ReplicationChannel::Destroy(channel);
+  }
+
+  // Idle: a quiet primary that keeps beating is still alive.
+  {
+    ReplicationChannel *channel = ReplicationChannel::Create();
+    if (!channel) return 1;
+    std::vector<Message> prefix(messages.begin(),
+                                messages.begin() + sync_messages);
+    pid_t replica = StartReplica(*channel, prefix, timeout_ns, false);
+    if (replica == -1) return 1;
+    ReplicationPrimary primary(*channel, timeout_ns);
+    bool lost = false;
+    auto start = Clock::now();
+    for (size_t i = 0; i < prefix.size() && !lost; ++i) {
+      if (i == prefix.size() / 2) {
+        const auto quiet_until =
+            Clock::now() + std::chrono::milliseconds(3 * timeout_ms);
+        while (Clock::now() < quiet_until) {
+          primary.Beat();
+          std::this_thread::sleep_for(
+              std::chrono::milliseconds(timeout_ms / 4));
+        }
+      }
+      lost = primary.Publish(prefix[i]) == 0;
+    }
+    if (!lost) lost = !primary.Finish();
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start)
+                    .count();
+    bool exited = WaitExited(replica, "replica of an idle primary");
+    bool same = exited && !lost;
+    ok &= same;
+    PrintRun("idle", prefix.size(), ms, LatencySummary(),
+             same ? "ok" : "DIFF");
+    ReplicationChannel::Destroy(channel);
+  }
+
+  // Failover.
+  {
+    ReplicationChannel *channel = ReplicationChannel::Create();
+    if (!channel) return 1;
+    std::printf("failover: SIGKILL the primary after %zu messages, %lld ms"
+                " timeout\n",
+                kill_at, (long long)timeout_ms);
+    std::fflush(stdout);
+    pid_t replica = StartReplica(*channel, messages, timeout_ns, true);
+    if (replica == -1) return 1;
+    pid_t primary = fork();
+    if (primary == -1) {
+      perror("fork");
+      return 1;
+    }
+    if (primary == 0) {
+      PrimaryStats stats;
+      RunPrimary(*channel, messages, timeout_ns, stats);
+      _exit(0);
+    }
+    for (Backoff backoff;
+         channel->published.load(std::memory_order_acquire) < kill_at;) {
+      backoff.Wait();
+    }
+    kill(primary, SIGKILL);
+    uint64_t published = channel->published.load(std::memory_order_acquire);
+    waitpid(primary, nullptr, 0);
+    bool exited = WaitExited(replica, "promoted replica");
+    bool same = exited && channel->final_hash.load() == reference_hash;
+    ok &= same;
+    std::printf("  primary killed at sequence %llu; final state %s\n",
+                (unsigned long long)published,
+                same ? "matches the standalone run" : "DIFFERS");
+    ReplicationChannel::Destroy(channel);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "MarketData.h"
+#include "OrderBookV6.h"
+#include "OrderBookV6Ring.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+// Level layout benchmark: intrusive lists of pool nodes (OrderBookV6) vs
+// ring buffers of slots (OrderBookV6Ring).
+//
+// Sweep: BOOK_ORDERS asks spread over BOOK_ORDERS / depth levels, then one
+// buy that takes the whole book. Cancel: the same book at depth 1000, a
+// random fraction of it cancelled (timed), then the sweep over what is left
+// (timed), so the ring pays for skipping its holes. An optional market data
+// file is replayed through both books. The run fails if a ring book sized
+// smaller than its ids loses track of an order.
+constexpr OrderId BOOK_ORDERS = 200000;
+constexpr Price BASE_PRICE = 1000;
+constexpr int REPEATS = 5;
+
+using Clock = std::chrono::steady_clock;
+
+double Millis(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+template <typename Book> Book *BuildAsks(OrderId depth) {
+  auto *book = new Book();
+  OrderId order_id = 1;
+  for (OrderId i = 0; i < BOOK_ORDERS; ++i) {
+    Price price = BASE_PRICE + static_cast<Price>(i % (BOOK_ORDERS / depth));
+    book->AddOrder(order_id++, Side::SELL, price, 10);
+  }
+  return book;
+}
+
+template <typename Book> double Sweep(OrderId depth) {
+  double total = 0;
+  for (int r = 0; r < REPEATS; ++r) {
+    Book *book = BuildAsks<Book>(depth);
+    auto start = Clock::now();
+    book->AddOrder(BOOK_ORDERS + 1, Side::BUY, MAX_PRICE - 1,
+                   static_cast<Quantity>(BOOK_ORDERS * 10));
+    total += Millis(Clock::now() - start);
+    delete book;
+  }
+  return total / REPEATS;
+}
+
+template <typename Book>
+void CancelThenSweep(double fraction, double &cancel_ms, double &sweep_ms) {
+  std::vector<OrderId> ids(BOOK_ORDERS);
+  for (OrderId i = 0; i < BOOK_ORDERS; ++i) ids[i] = i + 1;
+  std::mt19937_64 rng(3);
+  std::shuffle(ids.begin(), ids.end(), rng);
+  ids.resize(static_cast<size_t>(BOOK_ORDERS * fraction));
+
+  cancel_ms = sweep_ms = 0;
+  for (int r = 0; r < REPEATS; ++r) {
+    Book *book = BuildAsks<Book>(1000);
+    auto start = Clock::now();
+    for (OrderId id : ids) book->CancelOrder(id);
+    auto middle = Clock::now();
+    book->AddOrder(BOOK_ORDERS + 1, Side::BUY, MAX_PRICE - 1,
+                   static_cast<Quantity>(BOOK_ORDERS * 10));
+    auto end = Clock::now();
+    cancel_ms += Millis(middle - start);
+    sweep_ms += Millis(end - middle);
+    delete book;
+  }
+  cancel_ms /= REPEATS;
+  sweep_ms /= REPEATS;
+}
+
+template <typename Book> double Replay(const std::vector<Message> &messages) {
+  auto *book = new Book();
+  auto start = Clock::now();
+  for (const Message &msg : messages) {
+    if (msg.type == 'A') {
+      book->AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+    } else if (msg.type == 'C') {
+      book->CancelOrder(msg.order_id);
+    }
+  }
+  double ms = Millis(Clock::now() - start);
+  delete book;
+  return ms;
+}
+
+// A ring book with a 64-tick range and the minimum id range takes ids far
+// past it: the order map grows, so a cancelled one never trades and a
+// resting one does.
+bool IdsPastLimitFit() {
+  OrderBookV6Ring book(BookSizing{BookSizing::MIN_ORDERS,
+                                  BookSizing::MIN_ORDERS, 64});
+  const OrderId far = OrderId(BookSizing::MIN_ORDERS) * 100;
+  book.AddOrder(far, Side::SELL, 10, 5);
+  book.CancelOrder(far);
+  book.AddOrder(1, Side::BUY, 10, 5);
+  if (book.LastTradePrice() != 0) return false;
+  book.AddOrder(far + 1, Side::SELL, 9, 5);
+  return book.LastTradePrice() == 10;
+}
+
+int main(int argc, char *argv[]) {
+  std::printf("V6 sweep of %llu orders (ms)\n",
+              (unsigned long long)BOOK_ORDERS);
+  std::printf("  %-8s %10s %10s\n", "depth", "list", "ring");
+  for (OrderId depth : {OrderId(10), OrderId(100), OrderId(1000)}) {
+    std::printf("  %-8llu %10.2f %10.2f\n", (unsigned long long)depth,
+                Sweep<OrderBookV6>(depth), Sweep<OrderBookV6Ring>(depth));
+  }
+
+  std::printf("V6 random cancels at depth 1000, then sweep (ms)\n");
+  std::printf("  %-8s %10s %10s %10s %10s\n", "cancel", "list cxl",
+              "ring cxl", "list sweep", "ring sweep");
+  for (double fraction : {0.5, 0.9}) {
+    double list_cancel, list_sweep, ring_cancel, ring_sweep;
+    CancelThenSweep<OrderBookV6>(fraction, list_cancel, list_sweep);
+    CancelThenSweep<OrderBookV6Ring>(fraction, ring_cancel, ring_sweep);
+    std::printf("  %6.0f%%  %10.2f %10.2f %10.2f %10.2f\n", fraction * 100,
+                list_cancel, ring_cancel, list_sweep, ring_sweep);
+  }
+
+  if (!IdsPastLimitFit()) {
+    std::printf("ring book lost an order past its id limit\n");
+    return 1;
+  }
+  std::printf("ring ids past the sizing limit: ok\n");
+
+  if (argc > 1) {
+    std::vector<Message> messages;
+    if (!LoadMessages(argv[1], messages)) return 1;
+    std::printf("V6 replay of %s: list %.1f ms, ring %.1f ms\n", argv[1],
+                Replay<OrderBookV6>(messages),
+                Replay<OrderBookV6Ring>(messages));
+  }
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include "MarketData.h"
+#include "OrderBookV6.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+
+// A long trading session with ids that never repeat, through the direct
+// order index (an array sized MAX_ORDER_ID) or the hashed one (a table
+// sized for live orders, with pool slots recycled as internal handles).
+//
+// Flow follows scripts/generate_data_dense.py (prices ~ N(10000, 25),
+// quantity 1-100, ~55% adds), except that cancels always pick an id still
+// on the generator's list and the list is held near TARGET_LIVE, so the
+// number of resting orders stays bounded however long the session runs.
+// Messages are generated CHUNK at a time outside the timed region.
+//
+// Run each index in its own process so the RSS figures are its own. The
+// direct book stops once ids reach MAX_ORDER_ID.
+constexpr size_t CHUNK = 1000000;
+constexpr size_t REPORT_EVERY = 10000000;
+constexpr size_t PRESEED_ORDERS = 50000;
+constexpr size_t TARGET_LIVE = 200000;
+
+class SessionGenerator {
+public:
+  // Fills `messages` with the next `count` messages of the session.
+  void Next(std::vector<Message> &messages, size_t count) {
+    messages.clear();
+    for (size_t i = 0; i < count; ++i) {
+      Message msg{};
+      bool add = generated_ < PRESEED_ORDERS || active_.empty() ||
+                 (active_.size() < TARGET_LIVE && unit_(rng_) < 0.55);
+      if (add) {
+        msg.type = 'A';
+        msg.side = (rng_() & 1) ? Side::BUY : Side::SELL;
+        msg.price = static_cast<Price>(price_(rng_));
+        msg.quantity = quantity_(rng_);
+        msg.order_id = next_id_++;
+        active_.push_back(msg.order_id);
+      } else {
+        size_t index = rng_() % active_.size();
+        msg.type = 'C';
+        msg.order_id = active_[index];
+        active_[index] = active_.back();
+        active_.pop_back();
+      }
+      messages.push_back(msg);
+      ++generated_;
+    }
+  }
+
+  OrderId NextId() const { return next_id_; }
+
+private:
+  std::mt19937_64 rng_{11};
+  std::normal_distribution<double> price_{10000.0, 25.0};
+  std::uniform_int_distribution<Quantity> quantity_{1, 100};
+  std::uniform_real_distribution<double> unit_{0.0, 1.0};
+  std::vector<OrderId> active_;
+  OrderId next_id_ = 1;
+  size_t generated_ = 0;
+};
+
+// Resident and peak resident set size in MB, from /proc/self/status.
+void ReadRss(double &rss_mb, double &peak_mb) {
+  rss_mb = peak_mb = 0;
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      rss_mb = std::strtod(line.c_str() + 6, nullptr) / 1024.0;
+    } else if (line.compare(0, 6, "VmHWM:") == 0) {
+      peak_mb = std::strtod(line.c_str() + 6, nullptr) / 1024.0;
+    }
+  }
+}
+
+template <typename Book>
+int RunSession(const char *name, size_t total, bool ids_bounded) {
+  using Clock = std::chrono::steady_clock;
+  auto *book = new Book();
+  SessionGenerator generator;
+  std::vector<Message> messages;
+  messages.reserve(CHUNK);
+
+  std::printf("V6 %s session, %zu messages\n", name, total);
+  std::printf("  %12s %10s %10s %10s\n", "messages", "ms", "rss MB",
+              "peak MB");
+  Clock::duration elapsed{}, window{};
+  auto report = [&](size_t done) {
+    double rss_mb, peak_mb;
+    ReadRss(rss_mb, peak_mb);
+    std::printf("  %12zu %10.1f %10.1f %10.1f\n", done,
+                std::chrono::duration<double, std::milli>(window).count(),
+                rss_mb, peak_mb);
+    window = {};
+  };
+
+  size_t done = 0;
+  while (done < total) {
+    generator.Next(messages, std::min(CHUNK, total - done));
+    if (ids_bounded && generator.NextId() >= MAX_ORDER_ID) {
+      std::printf("  ids reach MAX_ORDER_ID after %zu messages\n", done);
+      break;
+    }
+    auto start = Clock::now();
+    for (const Message &msg : messages) {
+      if (msg.type == 'A') {
+        book->AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+      } else {
+        book->CancelOrder(msg.order_id);
+      }
+    }
+    auto spent = Clock::now() - start;
+    elapsed += spent;
+    window += spent;
+    done += messages.size();
+    if (done % REPORT_EVERY == 0) report(done);
+  }
+  if (done % REPORT_EVERY != 0) report(done);
+  double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+  std::printf("V6 %s total: %.1f ms, %.2f M msgs/s\n", name, ms,
+              done / ms / 1000.0);
+  delete book;
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || (std::strcmp(argv[1], "direct") != 0 &&
+                   std::strcmp(argv[1], "hashed") != 0)) {
+    std::fprintf(stderr, "usage: %s direct|hashed [messages]\n", argv[0]);
+    return 1;
+  }
+  size_t total = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000000;
+  if (std::strcmp(argv[1], "direct") == 0) {
+    return RunSession<OrderBookV6>("direct", total, true);
+  }
+  return RunSession<OrderBookV6Hashed>("hashed", total, false);
+}
@@ -0,0 +1,174 @@
+#include "MarketData.h"
+#include "OrderBookV6.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+
+// One message flow through OrderBookV6 and OrderBookV6Hashed, each at the
+// default sizing and at a BookSizing cut down to the flow: a 4096-tick
+// price range and 64k order ids. OrderBookV6SmallTick is the same cut made
+// at compile time (SmallTickBookTraits): uint16_t prices, uint32_t ids and
+// std::array levels, bitmaps and auction scratch inside the book.
+//
+// The flow fits the small sizing: prices ~ N(2048, 25) in ticks, quantity
+// 1-100, ~55% adds, cancels of ids the generator still holds, and ids
+// recycled below 65536 once cancelled, with at most MAX_LIVE held. Every
+// book must end with the same StateHash() as the default OrderBookV6. An
+// optional market data file is replayed through OrderBookV6 at the default
+// sizing and at one taken from that replay's Profile() and price range.
+constexpr size_t MESSAGES = 10000000;
+constexpr size_t MAX_LIVE = 50000;
+constexpr int REPEATS = 3;
+
+constexpr BookSizing SMALL_TICK_SIZING{MAX_LIVE, 1 << 16, 4096};
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<Message> GenerateFlow() {
+  std::mt19937_64 rng(17);
+  std::normal_distribution<double> price(2048.0, 25.0);
+  std::uniform_int_distribution<Quantity> quantity(1, 100);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<OrderId> free_ids, live_ids;
+  for (OrderId id = 1 << 16; id-- > 1;) free_ids.push_back(id);
+
+  std::vector<Message> messages;
+  messages.reserve(MESSAGES);
+  while (messages.size() < MESSAGES) {
+    Message msg{};
+    bool add = live_ids.empty() ||
+               (live_ids.size() < MAX_LIVE && unit(rng) < 0.55);
+    if (add) {
+      msg.type = 'A';
+      msg.side = (rng() & 1) ? Side::BUY : Side::SELL;
+      msg.price = static_cast<Price>(price(rng));
+      msg.quantity = quantity(rng);
+      msg.order_id = free_ids.back();
+      free_ids.pop_back();
+      live_ids.push_back(msg.order_id);
+    } else {
+      size_t index = rng() % live_ids.size();
+      msg.type = 'C';
+      msg.order_id = live_ids[index];
+      live_ids[index] = live_ids.back();
+      live_ids.pop_back();
+      free_ids.push_back(msg.order_id);
+    }
+    messages.push_back(msg);
+  }
+  return messages;
+}
+
+struct Outcome {
+  double ms;
+  uint64_t state_hash;
+  size_t reserved, touched;
+  BookProfile profile;
+};
+
+template <typename Book>
+double Replay(Book &book, const std::vector<Message> &messages) {
+  auto start = Clock::now();
+  for (const Message &msg : messages) {
+    if (msg.type == 'A') {
+      book.AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+    } else {
+      book.CancelOrder(msg.order_id);
+    }
+  }
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+template <typename Book>
+Outcome Run(const BookSizing &sizing, const std::vector<Message> &messages) {
+  Outcome outcome{};
+  for (int r = 0; r < REPEATS; ++r) {
+    auto *book = new Book(sizing);
+    double ms = Replay(*book, messages);
+    if (r == 0 || ms < outcome.ms) outcome.ms = ms;
+    outcome.state_hash = book->StateHash();
+    outcome.reserved = outcome.touched = 0;
+    for (const MemoryUse &use : book->MemoryReport()) {
+      outcome.reserved += use.reserved;
+      outcome.touched += use.touched;
+    }
+    outcome.profile = book->Profile();
+    delete book;
+  }
+  return outcome;
+}
+
+bool PrintRow(const char *name, const BookSizing &sizing, size_t messages,
+              const Outcome &outcome, const Outcome &reference) {
+  bool same = outcome.state_hash == reference.state_hash;
+  std::printf("  %-14s %7u %10.1f %10.1f %10.1f %10.2f %6s\n", name,
+              sizing.price_limit, outcome.reserved / 1048576.0,
+              outcome.touched / 1048576.0, outcome.ms,
+              messages / outcome.ms / 1000.0, same ? "ok" : "DIFF");
+  return same;
+}
+
+// A sizing past the traits' range must not build a book.
+bool RejectsWiderSizing(const BookSizing &sizing) {
+  try {
+    OrderBookV6SmallTick *book = new OrderBookV6SmallTick(sizing);
+    delete book;
+  } catch (const std::invalid_argument &) {
+    return true;
+  }
+  std::fprintf(stderr, "small-tick book accepted price_limit %u\n",
+               sizing.price_limit);
+  return false;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<Message> messages = GenerateFlow();
+  std::printf("V6 book sizings, %zu messages (best of %d, memory in MB)\n",
+              MESSAGES, REPEATS);
+  std::printf("  %-14s %7s %10s %10s %10s %10s %6s\n", "book", "prices",
+              "reserved", "touched", "ms", "M msgs/s", "state");
+
+  bool ok = true;
+  const BookSizing direct = OrderBookV6::DefaultSizing();
+  const BookSizing hashed = OrderBookV6Hashed::DefaultSizing();
+  Outcome reference = Run<OrderBookV6>(direct, messages);
+  ok &= PrintRow("direct", direct, MESSAGES, reference, reference);
+  ok &= PrintRow("direct 4096", SMALL_TICK_SIZING, MESSAGES,
+                 Run<OrderBookV6>(SMALL_TICK_SIZING, messages), reference);
+  ok &= PrintRow("hashed", hashed, MESSAGES,
+                 Run<OrderBookV6Hashed>(hashed, messages), reference);
+  ok &= PrintRow("hashed 4096", SMALL_TICK_SIZING, MESSAGES,
+                 Run<OrderBookV6Hashed>(SMALL_TICK_SIZING, messages),
+                 reference);
+  const BookSizing small_tick = OrderBookV6SmallTick::DefaultSizing();
+  ok &= PrintRow("small-tick", small_tick, MESSAGES,
+                 Run<OrderBookV6SmallTick>(small_tick, messages), reference);
+  ok &= RejectsWiderSizing(direct);
+
+  if (argc > 1) {
+    std::vector<Message> file;
+    if (!LoadMessages(argv[1], file)) return 1;
+    Price max_price = 0;
+    for (const Message &msg : file) {
+      if (msg.type == 'A') max_price = std::max(max_price, msg.price);
+    }
+    if (max_price >= MAX_PRICE) {
+      std::fprintf(stderr, "%s: prices must be below %u\n", argv[1],
+                   MAX_PRICE);
+      return 1;
+    }
+    Outcome file_reference = Run<OrderBookV6>(direct, file);
+    BookSizing profiled = BookSizing::FromProfile(file_reference.profile);
+    profiled.price_limit = max_price + 1;
+    std::printf("V6 replay of %s\n", argv[1]);
+    ok &= PrintRow("direct", direct, file.size(), file_reference,
+                   file_reference);
+    ok &= PrintRow("profiled", profiled, file.size(),
+                   Run<OrderBookV6>(profiled, file), file_reference);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include "OrderBookV6.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Stop cascade benchmark: a single aggressive buy lifts the first few ask
+// levels, which triggers buy stops, whose fills lift more levels and
+// trigger more stops, until every pending stop has been released.
+//
+// Layout for N stops: two stop-market buys of 100 per price starting just
+// above the book's base price, and 2N ask levels of 100 above that, so each
+// triggered price releases enough stops to cross the next one.
+//
+// Before timing, a hashed book takes stops with ids far past MAX_ORDER_ID
+// (its ids are unbounded): one is cancelled, one is triggered, and the
+// exit status is 1 if either is lost. The edges of the price range are
+// checked the same way, on a default and a 4096-tick book.
+bool LargeStopIdsHold() {
+  auto *book = new OrderBookV6Hashed();
+  const OrderId big = OrderId(1) << 40;
+  book->AddOrder(1, Side::SELL, 101, 10);
+  book->AddOrder(2, Side::SELL, 102, 10);
+  book->AddOrder(3, Side::BUY, 100, 10);
+  book->AddStopOrder(big, Side::BUY, 102, 10);
+  book->CancelOrder(big);
+  book->AddStopOrder(big + 1, Side::BUY, 101, 10);
+  book->AddOrder(4, Side::BUY, 101, 10);
+  DepthLevel level;
+  bool ok = book->LastTradePrice() == 102 &&
+            book->GetDepth(Side::SELL, 1, &level) == 0;
+  std::string error;
+  if (!book->VerifyInvariants(&error)) {
+    std::cerr << "large stop ids: " << error << std::endl;
+    ok = false;
+  }
+  delete book;
+  return ok;
+}
+
+// Stops at 1 and at PriceLimit() - 1 trigger on trades there; stops at 0
+// and at PriceLimit(), where nothing can trade, are refused.
+bool StopPriceEdgesHold(const BookSizing &sizing) {
+  auto *book = new OrderBookV6(sizing);
+  const Price limit = book->PriceLimit();
+  bool ok = !book->AddStopOrder(10, Side::SELL, 0, 5) &&
+            !book->AddStopOrder(11, Side::BUY, limit, 5) &&
+            !book->AddStopLimitOrder(12, Side::SELL, 0, 1, 5) &&
+            !book->AddStopLimitOrder(13, Side::BUY, limit, limit - 1, 5);
+
+  DepthLevel level;
+  book->AddOrder(1, Side::SELL, limit - 1, 6);
+  ok &= book->AddStopOrder(2, Side::BUY, limit - 1, 5);
+  book->AddOrder(3, Side::BUY, limit - 1, 1);
+  ok &= book->LastTradePrice() == limit - 1 &&
+        book->GetDepth(Side::SELL, 1, &level) == 0;
+
+  book->AddOrder(4, Side::BUY, 1, 6);
+  ok &= book->AddStopOrder(5, Side::SELL, 1, 5);
+  book->AddOrder(6, Side::SELL, 1, 1);
+  ok &= book->LastTradePrice() == 1 &&
+        book->GetDepth(Side::BUY, 1, &level) == 0;
+
+  std::string error;
+  if (!book->VerifyInvariants(&error)) {
+    std::cerr << "stop price edges: " << error << std::endl;
+    ok = false;
+  }
+  delete book;
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  OrderId num_stops = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 5000;
+  constexpr Price BASE_PRICE = 1000;
+  constexpr Quantity LEVEL_QTY = 100;
+
+  if (BASE_PRICE + 2 * num_stops + 1 >= MAX_PRICE) {
+    std::cerr << "Too many stops for MAX_PRICE" << std::endl;
+    return 1;
+  }
+
+  if (!LargeStopIdsHold()) {
+    std::cerr << "Stops with ids past MAX_ORDER_ID were lost" << std::endl;
+    return 1;
+  }
+  BookSizing small_tick = OrderBookV6::DefaultSizing();
+  small_tick.price_limit = 4096;
+  if (!StopPriceEdgesHold(OrderBookV6::DefaultSizing()) ||
+      !StopPriceEdgesHold(small_tick)) {
+    std::cerr << "Stops at the edges of the price range misbehaved"
+              << std::endl;
+    return 1;
+  }
+
+  auto *book = new OrderBookV6();
+  OrderId order_id = 1;
+
+  Price num_levels = 2 * num_stops;
+  for (Price i = 1; i <= num_levels; ++i) {
+    book->AddOrder(order_id++, Side::SELL, BASE_PRICE + i, LEVEL_QTY);
+  }
+  for (OrderId i = 0; i < num_stops; ++i) {
+    Price stop_price = BASE_PRICE + 1 + i / 2;
+    book->AddStopOrder(order_id++, Side::BUY, stop_price, LEVEL_QTY);
+  }
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+
+  // The sweep clears one level; everything after that is stop-driven.
+  book->AddOrder(order_id++, Side::BUY, BASE_PRICE + 1, LEVEL_QTY);
+
+  auto end_time = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      end_time - start_time);
+
+  Price levels_cleared = book->LastTradePrice() - BASE_PRICE;
+  std::cout << "V6 Stop Cascade: " << num_stops << " stops, "
+            << levels_cleared << " levels cleared in " << duration.count()
+            << " us ("
+            << (duration.count() * 1000.0 / static_cast<double>(num_stops))
+            << " ns/stop)" << std::endl;
+
+  delete book;
+  return 0;
+}
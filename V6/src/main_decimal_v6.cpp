@@ -0,0 +1,92 @@
+#include "MarketData.h"
+#include "OrderBookV6.h"
+#include "TickTable.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sys/mman.h>
+
+// main_fast_v6.cpp's CSV replay, for files with decimal prices
+// (scripts/generate_data_decimal.py). Prices are converted to a dense level
+// index once, here at ingress; the book itself never sees a decimal.
+
+// Tick schedule of the demo instrument, kept in sync with the generator:
+// 0.01 below 100.00, 0.05 from 100.00 up to 500.00.
+static const TickTable kDemoTickTable({{0, 100}, {100 * PRICE_SCALE, 500}},
+                                      500 * PRICE_SCALE);
+
+// Parses "101.25" into PRICE_DECIMALS fixed point. Digits beyond
+// PRICE_DECIMALS are dropped.
+inline DecimalPrice parse_decimal(const char *&ptr) {
+  DecimalPrice val = 0;
+  while (*ptr >= '0' && *ptr <= '9') {
+    val = val * 10 + (*ptr++ - '0');
+  }
+  unsigned decimals = 0;
+  if (*ptr == '.') {
+    ptr++;
+    while (*ptr >= '0' && *ptr <= '9') {
+      if (decimals < PRICE_DECIMALS) {
+        val = val * 10 + (*ptr - '0');
+        decimals++;
+      }
+      ptr++;
+    }
+  }
+  for (; decimals < PRICE_DECIMALS; ++decimals) {
+    val *= 10;
+  }
+  return val;
+}
+
+// The decimal price field for ParseMessage: the level on kDemoTickTable,
+// or 0 (never a valid level) for an off-grid or out-of-range price.
+struct DecimalLevel {
+  Price operator()(const char *&ptr) const {
+    Price level;
+    return kDemoTickTable.ToLevel(parse_decimal(ptr), level) ? level : 0;
+  }
+};
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <market_data_decimal.csv>"
+              << std::endl;
+    return 1;
+  }
+
+  const char *buffer;
+  size_t file_size;
+  if (!MapFile(argv[1], buffer, file_size)) return 1;
+
+  OrderBookV6 book;
+  const char *ptr = buffer;
+  const char *end = buffer + file_size;
+  uint64_t rejected = 0;
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+  while (ptr < end) {
+    Message msg;
+    ParseMessage(ptr, end, msg, DecimalLevel());
+    if (msg.type == 'A') {
+      if (msg.price != 0) {
+        book.AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+      } else {
+        rejected++;
+      }
+    } else if (msg.type == 'C') {
+      book.CancelOrder(msg.order_id);
+    }
+  }
+  PrintProcessingTime(start_time);
+
+  std::cout << "Rejected prices: " << rejected << std::endl;
+  if (book.LastTradePrice() != 0) {
+    DecimalPrice last = kDemoTickTable.ToPrice(book.LastTradePrice());
+    std::cout << "Last trade: " << last / PRICE_SCALE << "." << std::setw(2)
+              << std::setfill('0') << (last % PRICE_SCALE) / 100 << std::endl;
+  }
+
+  munmap((void *)buffer, file_size);
+  return 0;
+}
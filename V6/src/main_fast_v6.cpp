@@ -1,92 +1,648 @@
+#include "IngestPipeline.h"
+#include "MarketData.h"
+#include "MemoryFootprint.h"
 #include "OrderBookV6.h"
+#include "PerfCounters.h"
+#include "Runtime.h"
+#include "StreamReader.h"
+#include "Workloads.h"
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <fcntl.h>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
-// Inlined fast integer parser
-inline uint64_t parse_int(const char *&ptr) {
-  uint64_t val = 0;
-  while (*ptr >= '0' && *ptr <= '9') {
-    val = val * 10 + (*ptr++ - '0');
+// Applies the CSV line at ptr to the book and returns the start of the next.
+template <typename Book>
+inline const char *ApplyLine(Book &book, const char *ptr, const char *end) {
+  char type = *ptr;
+  ptr += 2; // Skip type and comma
+
+  char side_char = *ptr;
+  ptr += 2; // Skip side and comma
+
+  OrderId order_id = parse_int(ptr);
+
+  if (type == 'A') {
+    ptr++; // Skip comma
+    Price price = parse_int(ptr);
+    ptr++; // Skip comma
+    Quantity quantity = parse_int(ptr);
+
+    Side side = (side_char == 'B') ? Side::BUY : Side::SELL;
+    book.AddOrder(order_id, side, price, quantity);
+
+  } else if (type == 'C') {
+    book.CancelOrder(order_id);
+  }
+
+  // Move to the next line
+  while (ptr < end && *ptr != '\n') {
+    ptr++;
   }
-  return val;
+  if (ptr < end)
+    ptr++;
+  return ptr;
 }
 
-int main(int argc, char *argv[]) {
-  if (argc != 2) {
-    std::cerr << "Usage: " << argv[0] << " <market_data_file.csv>" << std::endl;
-    return 1;
+// Price of the first add in the file, where the warm-up centres its orders.
+inline Price FirstAddPrice(const char *ptr, const char *end) {
+  while (ptr < end) {
+    if (*ptr == 'A') {
+      ptr += 4;
+      parse_int(ptr);
+      ptr++;
+      return parse_int(ptr);
+    }
+    while (ptr < end && *ptr++ != '\n') {
+    }
+  }
+  return 0;
+}
+
+// --format binary: generate_workload's fixed-size records, applied as they
+// are mapped; there is nothing to parse.
+inline Message ToMessage(const BinaryWorkloadRecord &record) {
+  Message msg{};
+  msg.type = record.type;
+  msg.side = (record.side == 'B') ? Side::BUY : Side::SELL;
+  msg.order_id = record.order_id;
+  msg.price = record.price;
+  msg.quantity = record.quantity;
+  return msg;
+}
+
+inline Price FirstAddPrice(const BinaryWorkloadRecord *record,
+                           const BinaryWorkloadRecord *end) {
+  for (; record < end; ++record) {
+    if (record->type == 'A') return record->price;
   }
+  return 0;
+}
 
-  const char *filename = argv[1];
-  int fd = open(filename, O_RDONLY);
-  if (fd == -1) {
-    perror("open");
-    return 1;
+// One phase of a --counters run: wall time and this thread's counters.
+struct PhaseReport {
+  const char *name;
+  double ms;
+  PerfReading counters;
+};
+
+// Per-phase counters, raw and per million messages, as a table or JSON.
+// Counters the machine doesn't provide are n/a (null).
+void PrintPhases(const std::vector<PhaseReport> &phases, size_t messages,
+                 bool json) {
+  double millions = messages / 1e6;
+  if (json) {
+    std::printf("{\"messages\": %zu, \"phases\": [", messages);
+    for (size_t p = 0; p < phases.size(); ++p) {
+      const PhaseReport &phase = phases[p];
+      std::printf("%s\n  {\"name\": \"%s\", \"ms\": %.3f", p ? "," : "",
+                  phase.name, phase.ms);
+      for (const char *scale : {"counters", "per_million"}) {
+        std::printf(", \"%s\": {", scale);
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+          std::printf("%s\"%s\": ", e ? ", " : "", PERF_EVENT_NAMES[e]);
+          if (!phase.counters.valid[e]) {
+            std::printf("null");
+          } else if (scale[0] == 'c') {
+            std::printf("%llu", (unsigned long long)phase.counters.value[e]);
+          } else {
+            std::printf("%.1f", phase.counters.value[e] / millions);
+          }
+        }
+        std::printf("}");
+      }
+      std::printf("}");
+    }
+    std::printf("\n]}\n");
+    return;
+  }
+
+  std::printf("%-6s %10s", "phase", "ms");
+  for (const char *name : PERF_EVENT_NAMES) std::printf(" %14s", name);
+  std::printf("\n");
+  for (const PhaseReport &phase : phases) {
+    std::printf("%-6s %10.2f", phase.name, phase.ms);
+    for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+      if (phase.counters.valid[e]) {
+        std::printf(" %14.0f", phase.counters.value[e] / millions);
+      } else {
+        std::printf(" %14s", "n/a");
+      }
+    }
+    std::printf("\n");
   }
+  std::printf("(counters per million messages, %zu messages)\n", messages);
+}
+
+enum class InputMode { MAP, STREAM_MMAP, STREAM_URING };
+
+struct DriverOptions {
+  RuntimeConfig runtime;
+  const char *filename = nullptr;
+  size_t first_n = 0;
+  bool counters = false;
+  bool json = false;
+  InputMode input = InputMode::MAP;
+  bool binary = false; // --format binary: BinaryWorkloadRecords, not CSV
+  size_t window = size_t(64) << 20;
+  bool hashed = false;
+  unsigned parse_threads = 0; // 0: parse on the matcher thread
+  size_t verify_every = 0;    // --verify N: check invariants every N messages
+  bool state_hash = false;
+  const char *hash_log = nullptr; // --hash-log FILE: 8 bytes per message
+  const char *sizing_file = nullptr; // --sizing FILE: start the book smaller
+  const char *profile_out = nullptr; // --profile-out FILE: write one
+  bool memory = false;               // --memory: print MemoryReport()
+};
 
-  struct stat sb;
-  if (fstat(fd, &sb) == -1) {
-    perror("fstat");
+// The book's starting sizes: --sizing's file, or the compile-time limits.
+template <typename Book> bool SizingFor(const DriverOptions &options,
+                                        BookSizing &sizing) {
+  sizing = Book::DefaultSizing();
+  return !options.sizing_file || LoadSizing(options.sizing_file, sizing);
+}
+
+// --memory and --profile-out, after the run.
+template <typename Book>
+int ReportFootprint(const DriverOptions &options, const Book &book) {
+  if (options.memory) {
+    size_t reserved = 0, touched = 0;
+    std::printf("%-22s %12s %12s\n", "structure", "reserved KB", "touched KB");
+    for (const MemoryUse &use : book.MemoryReport()) {
+      std::printf("%-22s %12zu %12zu\n", use.name.c_str(), use.reserved >> 10,
+                  use.touched >> 10);
+      reserved += use.reserved;
+      touched += use.touched;
+    }
+    std::printf("%-22s %12zu %12zu\n", "total", reserved >> 10, touched >> 10);
+  }
+  if (options.profile_out) {
+    BookProfile profile = book.Profile();
+    std::string comment = "orderbook_v6 profile of " +
+                          std::string(options.filename) + ": peak " +
+                          std::to_string(profile.peak_resting_orders) +
+                          " resting orders, max order id " +
+                          std::to_string(profile.max_order_id);
+    if (!SaveSizing(options.profile_out, BookSizing::FromProfile(profile),
+                    comment)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Feeds spans of whole lines, or messages parsed elsewhere, to the book.
+// With --first N the first N messages are timed one by one; the clock
+// reads add to the total.
+template <typename Book> class LineFeeder {
+public:
+  LineFeeder(Book &book, size_t first_n) : book_(book), first_ns_(first_n) {
+    getrusage(RUSAGE_SELF, &usage_before_);
+  }
+
+  void Apply(const char *ptr, const char *end) {
+    if (checked_) {
+      while (ptr < end && !failed_) {
+        ptr = ApplyLine(book_, ptr, end);
+        AfterMessage();
+      }
+      return;
+    }
+    while (ptr < end && timed_ < first_ns_.size()) {
+      auto message_start = std::chrono::steady_clock::now();
+      ptr = ApplyLine(book_, ptr, end);
+      first_ns_[timed_++] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - message_start)
+                                .count();
+    }
+    while (ptr < end) {
+      ptr = ApplyLine(book_, ptr, end);
+    }
+  }
+
+  void Apply(const Message &msg) {
+    if (checked_) {
+      if (!failed_) {
+        ApplyMessage(msg);
+        AfterMessage();
+      }
+    } else if (timed_ < first_ns_.size()) {
+      auto message_start = std::chrono::steady_clock::now();
+      ApplyMessage(msg);
+      first_ns_[timed_++] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - message_start)
+                                .count();
+    } else {
+      ApplyMessage(msg);
+    }
+  }
+
+  // Checked mode for --verify and --hash-log: every message goes through
+  // AfterMessage, off the fast loop (and untimed by --first), and the first
+  // invariant violation stops the replay.
+  void EnableChecks(size_t verify_every, FILE *hash_log) {
+    verify_every_ = verify_every;
+    hash_log_ = hash_log;
+    checked_ = verify_every > 0 || hash_log;
+  }
+  bool Failed() const { return failed_; }
+
+  void ReportFirst() {
+    if (timed_ == 0) return;
+    first_ns_.resize(timed_);
+    rusage usage_after;
+    getrusage(RUSAGE_SELF, &usage_after);
+    int64_t total_ns = 0;
+    for (int64_t ns : first_ns_) total_ns += ns;
+    std::sort(first_ns_.begin(), first_ns_.end());
+    std::cout << "First " << first_ns_.size() << " messages: total "
+              << total_ns / 1000 << " us, p50 " << first_ns_[first_ns_.size() / 2]
+              << " ns, p99 " << first_ns_[first_ns_.size() * 99 / 100]
+              << " ns, max " << first_ns_.back() << " ns" << std::endl;
+    std::cout << "Page faults while matching: "
+              << usage_after.ru_minflt - usage_before_.ru_minflt << " minor, "
+              << usage_after.ru_majflt - usage_before_.ru_majflt << " major"
+              << std::endl;
+  }
+
+private:
+  void ApplyMessage(const Message &msg) {
+    if (msg.type == 'A') {
+      book_.AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+    } else if (msg.type == 'C') {
+      book_.CancelOrder(msg.order_id);
+    }
+  }
+
+  void AfterMessage() {
+    ++messages_;
+    if (hash_log_) {
+      uint64_t hash = book_.StateHash();
+      std::fwrite(&hash, sizeof hash, 1, hash_log_);
+    }
+    if (verify_every_ && messages_ % verify_every_ == 0) {
+      std::string error;
+      if (!book_.VerifyInvariants(&error)) {
+        std::cerr << "invariant violated after message " << messages_ << ": "
+                  << error << std::endl;
+        failed_ = true;
+      }
+    }
+  }
+
+  Book &book_;
+  std::vector<int64_t> first_ns_;
+  size_t timed_ = 0;
+  rusage usage_before_;
+  bool checked_ = false;
+  bool failed_ = false;
+  size_t verify_every_ = 0;
+  FILE *hash_log_ = nullptr;
+  size_t messages_ = 0;
+};
+
+// --state-hash / --hash-log / --verify setup before the timed loop, and the
+// final hash and check after it. Returns false if the run must stop.
+template <typename Book>
+bool StartChecks(const DriverOptions &options, Book &book,
+                 LineFeeder<Book> &feeder, FILE *&hash_log) {
+  if (options.state_hash || options.hash_log || options.verify_every) {
+    book.EnableStateHash();
+  }
+  if (options.hash_log) {
+    hash_log = std::fopen(options.hash_log, "wb");
+    if (!hash_log) {
+      perror("fopen");
+      return false;
+    }
+  }
+  feeder.EnableChecks(options.verify_every, hash_log);
+  return true;
+}
+
+template <typename Book>
+int FinishChecks(const DriverOptions &options, const Book &book,
+                 const LineFeeder<Book> &feeder, FILE *hash_log) {
+  if (hash_log) std::fclose(hash_log);
+  if (feeder.Failed()) return 1;
+  if (options.verify_every) {
+    std::string error;
+    if (!book.VerifyInvariants(&error)) {
+      std::cerr << "invariant violated at end of input: " << error << std::endl;
+      return 1;
+    }
+  }
+  if (options.state_hash) {
+    std::printf("State hash: %016llx\n", (unsigned long long)book.StateHash());
+  }
+  return 0;
+}
+
+// --stream: the file is read a window at a time (StreamReader.h), so only
+// a couple of windows are ever resident. Reading is part of the timed loop.
+template <typename Book, typename Reader>
+int RunStreaming(const DriverOptions &options, Reader &reader) {
+  BookSizing sizing;
+  if (!SizingFor<Book>(options, sizing)) return 1;
+  Book book(sizing);
+  if (options.runtime.prefault) book.Prefault();
+  const char *begin, *end;
+  if (!reader.Next(begin, end)) return 1;
+  if (options.runtime.warmup_orders > 0) {
+    book.WarmUp(FirstAddPrice(begin, end), options.runtime.warmup_orders);
+  }
+  if (options.runtime.realtime_priority > 0) {
+    SetRealtimePriority(options.runtime.realtime_priority);
+  }
+  LineFeeder<Book> feeder(book, options.first_n);
+  FILE *hash_log = nullptr;
+  if (!StartChecks(options, book, feeder, hash_log)) return 1;
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+  do {
+    feeder.Apply(begin, end);
+  } while (!feeder.Failed() && reader.Next(begin, end));
+  PrintProcessingTime(start_time);
+  feeder.ReportFirst();
+  int status = FinishChecks(options, book, feeder, hash_log);
+  return status ? status : ReportFootprint(options, book);
+}
+
+template <typename Book> int Run(const DriverOptions &options) {
+  const RuntimeConfig &config = options.runtime;
+  if (options.input != InputMode::MAP) {
+    int fd = open(options.filename, O_RDONLY);
+    if (fd == -1) {
+      perror("open");
+      return 1;
+    }
+    int status = 1;
+    if (options.input == InputMode::STREAM_MMAP) {
+      MmapStreamReader reader(fd, options.window);
+      status = RunStreaming<Book>(options, reader);
+    } else {
+      UringStreamReader reader(fd, options.window);
+      if (reader.Ok()) status = RunStreaming<Book>(options, reader);
+    }
     close(fd);
-    return 1;
+    return status;
   }
-  size_t file_size = sb.st_size;
 
-  const char *buffer =
-      (const char *)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
-  if (buffer == MAP_FAILED) {
-    perror("mmap");
+  BookSizing sizing;
+  if (!SizingFor<Book>(options, sizing)) return 1;
+  const char *buffer = nullptr;
+  size_t file_size = 0;
+  std::vector<PhaseReport> phases;
+  auto load_file = [&]() {
+    int fd = open(options.filename, O_RDONLY);
+    if (fd == -1) {
+      perror("open");
+      return;
+    }
+
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+      perror("fstat");
+      close(fd);
+      return;
+    }
+    file_size = sb.st_size;
+
+    void *mapped = mmap(NULL, file_size, PROT_READ,
+                        MAP_PRIVATE | (config.prefault ? MAP_POPULATE : 0), fd,
+                        0);
     close(fd);
+    if (mapped == MAP_FAILED) {
+      perror("mmap");
+      return;
+    }
+    buffer = static_cast<const char *>(mapped);
+    if (config.prefault) PrefaultRead(buffer, file_size);
+  };
+  auto load = [&]() {
+    std::unique_ptr<PerfCounters> load_counters;
+    auto load_start = std::chrono::steady_clock::now();
+    if (options.counters) {
+      // Opened here so they count whichever thread does the loading.
+      load_counters = std::make_unique<PerfCounters>();
+      load_counters->Start();
+    }
+    load_file();
+    if (options.counters) {
+      PerfReading reading = load_counters->Stop();
+      phases.push_back({"load",
+                        std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - load_start)
+                            .count(),
+                        reading});
+    }
+  };
+  if (config.io_cpu >= 0) {
+    std::thread io([&]() {
+      PinThread(pthread_self(), config.io_cpu);
+      load();
+    });
+    io.join();
+  } else {
+    load();
+  }
+  if (!buffer) return 1;
+  const auto *records = reinterpret_cast<const BinaryWorkloadRecord *>(buffer);
+  const auto *records_end = records + file_size / sizeof(BinaryWorkloadRecord);
+  if (options.binary && file_size % sizeof(BinaryWorkloadRecord) != 0) {
+    std::cerr << options.filename << ": not a whole number of "
+              << sizeof(BinaryWorkloadRecord) << "-byte records" << std::endl;
+    munmap((void *)buffer, file_size);
     return 1;
   }
-  close(fd);
 
-  OrderBookV6 book;
+  Book book(sizing);
+  if (config.prefault) book.Prefault();
   const char *ptr = buffer;
   const char *end = buffer + file_size;
+  if (config.warmup_orders > 0) {
+    book.WarmUp(options.binary ? FirstAddPrice(records, records_end)
+                               : FirstAddPrice(ptr, end),
+                config.warmup_orders);
+  }
+  if (config.realtime_priority > 0) SetRealtimePriority(config.realtime_priority);
 
-  auto start_time = std::chrono::high_resolution_clock::now();
-
-  while (ptr < end) {
-    char type = *ptr;
-    ptr += 2; // Skip type and comma
-
-    char side_char = *ptr;
-    ptr += 2; // Skip side and comma
-
-    OrderId order_id = parse_int(ptr);
+  if (options.counters) {
+    // Parsing and matching run as separate passes here so that each gets
+    // its own counters; Processing Time is their sum. --memory and
+    // --profile-out are reported after them, as in the other modes.
+    using Clock = std::chrono::steady_clock;
+    auto millis = [](Clock::duration d) {
+      return std::chrono::duration<double, std::milli>(d).count();
+    };
+    PerfCounters matcher_counters;
+    if (!matcher_counters.Available()) {
+      std::cerr << "perf_event_open: no hardware counters available"
+                << std::endl;
+    }
 
-    if (type == 'A') {
-      ptr++; // Skip comma
-      Price price = parse_int(ptr);
-      ptr++; // Skip comma
-      Quantity quantity = parse_int(ptr);
+    std::vector<Message> messages;
+    auto parse_start = Clock::now();
+    matcher_counters.Start();
+    ParseMessages(ptr, end, messages);
+    PerfReading parse_reading = matcher_counters.Stop();
+    phases.push_back({"parse", millis(Clock::now() - parse_start), parse_reading});
 
-      Side side = (side_char == 'B') ? Side::BUY : Side::SELL;
-      book.AddOrder(order_id, side, price, quantity);
+    auto match_start = Clock::now();
+    matcher_counters.Start();
+    for (const Message &msg : messages) {
+      if (msg.type == 'A') {
+        book.AddOrder(msg.order_id, msg.side, msg.price, msg.quantity);
+      } else if (msg.type == 'C') {
+        book.CancelOrder(msg.order_id);
+      }
+    }
+    PerfReading match_reading = matcher_counters.Stop();
+    phases.push_back({"match", millis(Clock::now() - match_start), match_reading});
 
-    } else if (type == 'C') {
-      book.CancelOrder(order_id);
+    if (!options.json) {
+      std::cout << "V6 Processing Time: "
+                << static_cast<long>(phases[phases.size() - 2].ms +
+                                     phases.back().ms)
+                << " ms" << std::endl;
     }
+    PrintPhases(phases, messages.size(), options.json);
+    munmap((void *)buffer, file_size);
+    return ReportFootprint(options, book);
+  }
 
-    // Move to the next line
-    while (ptr < end && *ptr != '\n') {
-      ptr++;
+  LineFeeder<Book> feeder(book, options.first_n);
+  FILE *hash_log = nullptr;
+  if (!StartChecks(options, book, feeder, hash_log)) {
+    munmap((void *)buffer, file_size);
+    return 1;
+  }
+  auto start_time = std::chrono::high_resolution_clock::now();
+  if (options.binary) {
+    for (const auto *record = records; record < records_end; ++record) {
+      feeder.Apply(ToMessage(*record));
     }
-    if (ptr < end)
-      ptr++;
+  } else if (options.parse_threads > 0) {
+    // --parse-threads: workers parse chunks of the mapping and the book
+    // thread only applies messages. Starting them is inside the timing.
+    ParallelIngest ingest(ptr, end - ptr, options.parse_threads,
+                          config.matcher_cpu);
+    ingest.Drain([&](const Message &msg) { feeder.Apply(msg); });
+  } else {
+    feeder.Apply(ptr, end);
   }
+  PrintProcessingTime(start_time);
+  feeder.ReportFirst();
 
-  auto end_time = std::chrono::high_resolution_clock::now();
-  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-      end_time - start_time);
+  munmap((void *)buffer, file_size);
+  int status = FinishChecks(options, book, feeder, hash_log);
+  return status ? status : ReportFootprint(options, book);
+}
+
+int main(int argc, char *argv[]) {
+  DriverOptions options;
+  bool usage = false;
+  for (int i = 1; i < argc && !usage; ++i) {
+    if (ParseRuntimeOption(argc, argv, i, options.runtime)) continue;
+    std::string arg = argv[i];
+    if (arg == "--first" && i + 1 < argc) {
+      options.first_n = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--counters") {
+      options.counters = true;
+    } else if (arg == "--json") {
+      options.counters = options.json = true;
+    } else if (arg == "--stream" && i + 1 < argc) {
+      std::string mode = argv[++i];
+      if (mode == "mmap") options.input = InputMode::STREAM_MMAP;
+      else if (mode == "uring") options.input = InputMode::STREAM_URING;
+      else usage = true;
+    } else if (arg == "--format" && i + 1 < argc) {
+      std::string format = argv[++i];
+      if (format == "csv") options.binary = false;
+      else if (format == "binary") options.binary = true;
+      else usage = true;
+    } else if (arg == "--window" && i + 1 < argc) {
+      options.window = std::strtoull(argv[++i], nullptr, 10) << 20;
+    } else if (arg == "--hashed") {
+      options.hashed = true;
+    } else if (arg == "--parse-threads" && i + 1 < argc) {
+      options.parse_threads = std::atoi(argv[++i]);
+    } else if (arg == "--verify" && i + 1 < argc) {
+      options.verify_every = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--state-hash") {
+      options.state_hash = true;
+    } else if (arg == "--hash-log" && i + 1 < argc) {
+      options.hash_log = argv[++i];
+    } else if (arg == "--sizing" && i + 1 < argc) {
+      options.sizing_file = argv[++i];
+    } else if (arg == "--profile-out" && i + 1 < argc) {
+      options.profile_out = argv[++i];
+    } else if (arg == "--memory") {
+      options.memory = true;
+    } else if (!options.filename && arg[0] != '-') {
+      options.filename = argv[i];
+    } else {
+      usage = true;
+    }
+  }
+  if ((options.counters || options.parse_threads > 0) &&
+      options.input != InputMode::MAP) {
+    usage = true;
+  }
+  if (options.counters &&
+      (options.verify_every || options.state_hash || options.hash_log ||
+       options.first_n || options.parse_threads > 0)) {
+    usage = true;
+  }
+  // --json output is the JSON document alone.
+  if (options.json && options.memory) usage = true;
+  if (options.binary && (options.input != InputMode::MAP ||
+                         options.counters || options.parse_threads > 0)) {
+    usage = true;
+  }
+  if (usage || !options.filename) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--cpu N|auto] [--io-cpu N] [--mlock] [--prefault]"
+                 " [--warmup N] [--rt PRIO] [--first N] [--counters|--json]"
+                 " [--stream mmap|uring] [--window MB] [--hashed]"
+                 " [--parse-threads N] [--state-hash] [--hash-log FILE]"
+                 " [--verify N] [--sizing FILE] [--profile-out FILE]"
+                 " [--memory] [--format csv|binary] <market_data_file>"
+              << std::endl;
+    std::cerr << "--prefault faults in the input mapping and the book's"
+                 " preallocated arrays (pool, index, levels, auction"
+                 " scratch) before the first message"
+              << std::endl;
+    std::cerr << "--counters/--json and --parse-threads need the whole file"
+                 " mapped (no --stream); --counters/--json can't be combined"
+                 " with --state-hash, --hash-log, --verify, --first or"
+                 " --parse-threads, and --json not with --memory"
+              << std::endl;
+    std::cerr << "--format binary reads generate_workload's binary records"
+                 " and needs the whole file mapped (no --stream,"
+                 " --counters/--json or --parse-threads)"
+              << std::endl;
+    return 1;
+  }
 
-  std::cout << "V4 Processing Time: " << duration.count() << " ms" << std::endl;
+  const RuntimeConfig &config = options.runtime;
+  if (config.matcher_cpu >= 0 && PinThread(pthread_self(), config.matcher_cpu)) {
+    std::cerr << "matcher on cpu " << config.matcher_cpu
+              << (IsIsolated(config.matcher_cpu) ? " (isolated)" : "")
+              << std::endl;
+  }
+  if (config.lock_memory) LockMemory();
 
-  munmap((void *)buffer, file_size);
-  return 0;
+  // The hashed order index takes ids of any size, as long captures need.
+  return options.hashed ? Run<OrderBookV6Hashed>(options)
+                        : Run<OrderBookV6>(options);
 }
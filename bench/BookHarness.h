@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Shared main() for the per-version bench_book_* drivers. The file is
+// parsed up front, then replayed into a fresh book twice: once timed end to
+// end for throughput, once timing every message for the latency
+// percentiles (which include the clock reads). Prints one JSON line.
+//
+// Book must provide AddOrder(id, side, price, quantity) and
+// CancelOrder(id); SideType is that version's Side.
+
+struct HarnessMessage {
+  char type;
+  char side;
+  uint64_t order_id;
+  uint64_t price;
+  uint64_t quantity;
+};
+
+inline bool ReadHarnessMessages(const char *path,
+                                std::vector<HarnessMessage> &out) {
+  std::ifstream file(path);
+  if (!file) {
+    std::perror(path);
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    HarnessMessage msg{};
+    unsigned long long id = 0, price = 0, quantity = 0;
+    if (std::sscanf(line.c_str(), "%c,%c,%llu,%llu,%llu", &msg.type, &msg.side,
+                    &id, &price, &quantity) < 3) {
+      continue;
+    }
+    msg.order_id = id;
+    msg.price = price;
+    msg.quantity = quantity;
+    out.push_back(msg);
+  }
+  return true;
+}
+
+template <typename Book, typename SideType>
+inline void ApplyHarnessMessage(Book &book, const HarnessMessage &msg) {
+  if (msg.type == 'A') {
+    book.AddOrder(msg.order_id, msg.side == 'B' ? SideType::BUY : SideType::SELL,
+                  msg.price, msg.quantity);
+  } else if (msg.type == 'C') {
+    book.CancelOrder(msg.order_id);
+  }
+}
+
+template <typename Book, typename SideType>
+int RunBookHarness(int argc, char *argv[]) {
+  using Clock = std::chrono::steady_clock;
+  if (argc != 2) {
+    std::fprintf(stderr, "Usage: %s <market_data_file.csv>\n", argv[0]);
+    return 1;
+  }
+  std::vector<HarnessMessage> messages;
+  if (!ReadHarnessMessages(argv[1], messages) || messages.empty()) return 1;
+
+  // Books are heap-allocated: some are far too large for the stack.
+  auto *book = new Book();
+  auto start = Clock::now();
+  for (const HarnessMessage &msg : messages) {
+    ApplyHarnessMessage<Book, SideType>(*book, msg);
+  }
+  double ms = std::chrono::duration<double, std::milli>(Clock::now() - start)
+                  .count();
+  delete book;
+
+  std::vector<uint32_t> latency_ns(messages.size());
+  book = new Book();
+  for (size_t i = 0; i < messages.size(); ++i) {
+    auto message_start = Clock::now();
+    ApplyHarnessMessage<Book, SideType>(*book, messages[i]);
+    latency_ns[i] = static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             message_start)
+            .count());
+  }
+  delete book;
+  std::sort(latency_ns.begin(), latency_ns.end());
+
+  std::printf("{\"messages\": %zu, \"ms\": %.3f, \"p50_ns\": %u, "
+              "\"p99_ns\": %u}\n",
+              messages.size(), ms, latency_ns[latency_ns.size() / 2],
+              latency_ns[latency_ns.size() * 99 / 100]);
+  return 0;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Fixed-seed market data for the benchmark suite, in the CSV format of
+// scripts/generate_data_*.py ("A,B,id,price,qty" / "C,B,id,0,0").
+//
+// Prices and choices come from splitmix64 and a hand-written Box-Muller
+// rather than <random> distributions, whose output differs between
+// standard libraries, so a given seed produces the same file everywhere.
+
+struct WorkloadMessage {
+  char type; // 'A' add, 'C' cancel
+  char side; // 'B' or 'S'
+  uint64_t order_id;
+  uint64_t price;
+  uint64_t quantity;
+};
+
+// Record of generate_workload --format binary: fixed-size, native byte
+// order, no header. symbol is 0 unless --symbols > 1.
+struct BinaryWorkloadRecord {
+  uint64_t order_id;
+  uint32_t price;
+  uint32_t quantity;
+  uint32_t symbol;
+  char type;
+  char side;
+  uint8_t padding[2];
+};
+static_assert(sizeof(BinaryWorkloadRecord) == 24, "unexpected padding");
+
+class WorkloadRng {
+public:
+  explicit WorkloadRng(uint64_t seed) : state_(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+  // Uniform in [lo, hi].
+  uint64_t Uniform(uint64_t lo, uint64_t hi) {
+    return lo + Next() % (hi - lo + 1);
+  }
+  double Unit() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+  double Normal(double mean, double stddev) {
+    double u1 = Unit(), u2 = Unit();
+    if (u1 < 1e-300) u1 = 1e-300;
+    return mean +
+           stddev * std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+  }
+
+private:
+  uint64_t state_;
+};
+
+enum class Workload { DENSE, SPARSE, CANCEL_HEAVY, SWEEP_HEAVY, DEEP_QUEUE };
+
+struct WorkloadSpec {
+  Workload workload;
+  const char *name;
+  uint64_t seed;
+};
+
+// dense / sparse: scripts/generate_data_dense.py and _sparse.py.
+// cancel_heavy: dense prices, nine cancels for every ten adds.
+// sweep_heavy: a wider dense book where one message in 50 is a large
+//   aggressive order priced 100 ticks through the touch.
+// deep_queue: eleven price levels, so every level holds a long queue and
+//   cancels land in the middle of it.
+constexpr WorkloadSpec WORKLOADS[] = {
+    {Workload::DENSE, "dense", 1},
+    {Workload::SPARSE, "sparse", 2},
+    {Workload::CANCEL_HEAVY, "cancel_heavy", 3},
+    {Workload::SWEEP_HEAVY, "sweep_heavy", 4},
+    {Workload::DEEP_QUEUE, "deep_queue", 5},
+};
+
+inline std::vector<WorkloadMessage>
+GenerateWorkload(const WorkloadSpec &spec, size_t messages,
+                 size_t preseed_orders) {
+  WorkloadRng rng(spec.seed);
+  const double add_ratio =
+      spec.workload == Workload::CANCEL_HEAVY ? 1.0 / 1.9 : 0.55;
+
+  auto price = [&]() -> uint64_t {
+    switch (spec.workload) {
+    case Workload::SPARSE:
+      return rng.Uniform(1, 20000);
+    case Workload::SWEEP_HEAVY:
+      return static_cast<uint64_t>(rng.Normal(10000.0, 50.0));
+    case Workload::DEEP_QUEUE:
+      return rng.Uniform(9995, 10005);
+    default:
+      return static_cast<uint64_t>(rng.Normal(10000.0, 25.0));
+    }
+  };
+
+  std::vector<WorkloadMessage> out;
+  out.reserve(preseed_orders + messages);
+  std::vector<uint64_t> active;
+  uint64_t order_id = 1;
+  for (size_t i = 0; i < preseed_orders + messages; ++i) {
+    WorkloadMessage msg{'A', 'B', 0, 0, 0};
+    bool preseed = i < preseed_orders;
+    if (preseed || active.empty() || rng.Unit() < add_ratio) {
+      msg.side = (rng.Next() & 1) ? 'B' : 'S';
+      msg.price = price();
+      msg.quantity = rng.Uniform(1, 100);
+      if (!preseed && spec.workload == Workload::SWEEP_HEAVY &&
+          rng.Uniform(0, 49) == 0) {
+        msg.price = msg.side == 'B' ? 10100 : 9900;
+        msg.quantity = rng.Uniform(2000, 5000);
+      }
+      msg.order_id = order_id++;
+      active.push_back(msg.order_id);
+    } else {
+      size_t index = rng.Next() % active.size();
+      msg.type = 'C';
+      msg.order_id = active[index];
+      active[index] = active.back();
+      active.pop_back();
+    }
+    out.push_back(msg);
+  }
+  return out;
+}
+
+inline bool WriteWorkload(const std::string &path,
+                          const std::vector<WorkloadMessage> &messages) {
+  FILE *file = std::fopen(path.c_str(), "w");
+  if (!file) {
+    std::perror(path.c_str());
+    return false;
+  }
+  for (const WorkloadMessage &msg : messages) {
+    std::fprintf(file, "%c,%c,%llu,%llu,%llu\n", msg.type, msg.side,
+                 (unsigned long long)msg.order_id,
+                 (unsigned long long)msg.price,
+                 (unsigned long long)msg.quantity);
+  }
+  return std::fclose(file) == 0;
+}
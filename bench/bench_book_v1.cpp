@@ -0,0 +1,6 @@
+#include "OrderBookV1.h"
+#include "BookHarness.h"
+
+int main(int argc, char *argv[]) {
+  return RunBookHarness<OrderBookV1, Side>(argc, argv);
+}
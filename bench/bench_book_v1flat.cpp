@@ -0,0 +1,6 @@
+#include "OrderBookV1Flat.h"
+#include "BookHarness.h"
+
+int main(int argc, char *argv[]) {
+  return RunBookHarness<OrderBookV1Flat, Side>(argc, argv);
+}
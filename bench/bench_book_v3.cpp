@@ -0,0 +1,6 @@
+#include "OrderBookV3.h"
+#include "BookHarness.h"
+
+int main(int argc, char *argv[]) {
+  return RunBookHarness<OrderBookV3, Side>(argc, argv);
+}
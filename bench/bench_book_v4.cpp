@@ -0,0 +1,6 @@
+#include "OrderBookV4.h"
+#include "BookHarness.h"
+
+int main(int argc, char *argv[]) {
+  return RunBookHarness<OrderBookV4, Side>(argc, argv);
+}
@@ -0,0 +1,6 @@
+#include "OrderBookV6.h"
+#include "BookHarness.h"
+
+int main(int argc, char *argv[]) {
+  return RunBookHarness<OrderBookV6, Side>(argc, argv);
+}
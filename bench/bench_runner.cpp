@@ -0,0 +1,327 @@
+#include "Workloads.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Benchmark suite: generates the fixed-seed workloads (Workloads.h), runs
+// every book version's bench_book_* driver on each of them several times,
+// and reports the median throughput and p99 latency with a bootstrap 95%
+// confidence interval. With --baseline it compares the medians against a
+// stored result file and exits 1 if any throughput fell, or p99 rose, by
+// more than the allowed percentage, or if a case is in only one of them.
+// --write-baseline stores this run's results in the same format.
+//
+// Baselines only mean something on the machine (and build) that recorded
+// them; re-record after changing either.
+
+constexpr const char *BOOKS[] = {"v1", "v1flat", "v3", "v4", "v6"};
+constexpr int BOOTSTRAP_SAMPLES = 2000;
+
+struct Options {
+  int runs = 5;
+  size_t messages = 200000;
+  size_t preseed = 20000;
+  std::string data_dir = "bench_data";
+  std::string baseline;
+  std::string write_baseline;
+  std::vector<std::string> books;
+  std::vector<std::string> workloads;
+  double max_throughput_drop_pct = 10.0;
+  double max_p99_rise_pct = 25.0;
+};
+
+struct Estimate {
+  double median = 0;
+  double low = 0;
+  double high = 0;
+};
+
+struct Result {
+  std::string workload;
+  std::string book;
+  Estimate msgs_per_sec;
+  Estimate p99_ns;
+};
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// Median and percentile-bootstrap 95% interval of the median.
+Estimate Estimate95(const std::vector<double> &values) {
+  Estimate estimate;
+  estimate.median = Median(values);
+  WorkloadRng rng(42);
+  std::vector<double> medians(BOOTSTRAP_SAMPLES);
+  std::vector<double> sample(values.size());
+  for (double &median : medians) {
+    for (double &value : sample) value = values[rng.Next() % values.size()];
+    median = Median(sample);
+  }
+  std::sort(medians.begin(), medians.end());
+  estimate.low = medians[BOOTSTRAP_SAMPLES * 25 / 1000];
+  estimate.high = medians[BOOTSTRAP_SAMPLES * 975 / 1000];
+  return estimate;
+}
+
+std::string SelfDirectory() {
+  char path[4096];
+  ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  if (length <= 0) return ".";
+  path[length] = '\0';
+  std::string self(path);
+  return self.substr(0, self.rfind('/'));
+}
+
+std::vector<std::string> SplitList(const char *list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) items.push_back(item);
+  }
+  return items;
+}
+
+bool Contains(const std::vector<std::string> &list, const std::string &item) {
+  return list.empty() || std::find(list.begin(), list.end(), item) != list.end();
+}
+
+// Runs one driver once; false if it failed or printed something unexpected.
+bool RunDriver(const std::string &driver, const std::string &data,
+               double &ms, double &p99_ns, size_t &messages) {
+  std::string command = "'" + driver + "' '" + data + "'";
+  FILE *pipe = popen(command.c_str(), "r");
+  if (!pipe) return false;
+  char line[512] = {};
+  bool read = std::fgets(line, sizeof(line), pipe) != nullptr;
+  int status = pclose(pipe);
+  if (!read || status != 0) return false;
+  double p50_ns;
+  return std::sscanf(line,
+                     "{\"messages\": %zu, \"ms\": %lf, \"p50_ns\": %lf, "
+                     "\"p99_ns\": %lf}",
+                     &messages, &ms, &p50_ns, &p99_ns) == 4;
+}
+
+bool WriteResults(const std::string &path, const Options &options,
+                  const std::vector<Result> &results) {
+  FILE *file = std::fopen(path.c_str(), "w");
+  if (!file) {
+    std::perror(path.c_str());
+    return false;
+  }
+  std::fprintf(file, "{\n  \"messages\": %zu,\n  \"preseed\": %zu,\n"
+                     "  \"runs\": %d,\n  \"results\": [",
+               options.messages, options.preseed, options.runs);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    std::fprintf(file,
+                 "%s\n    {\"workload\": \"%s\", \"book\": \"%s\", "
+                 "\"msgs_per_sec\": %.0f, \"msgs_per_sec_ci\": [%.0f, %.0f], "
+                 "\"p99_ns\": %.0f, \"p99_ns_ci\": [%.0f, %.0f]}",
+                 i ? "," : "", r.workload.c_str(), r.book.c_str(),
+                 r.msgs_per_sec.median, r.msgs_per_sec.low,
+                 r.msgs_per_sec.high, r.p99_ns.median, r.p99_ns.low,
+                 r.p99_ns.high);
+  }
+  std::fprintf(file, "\n  ]\n}\n");
+  return std::fclose(file) == 0;
+}
+
+// Reads the file WriteResults produces: one result object per line of the
+// "results" array, fields found by key.
+bool ReadResults(const std::string &path, std::vector<Result> &results,
+                 size_t &messages) {
+  std::ifstream file(path);
+  if (!file) {
+    std::perror(path.c_str());
+    return false;
+  }
+  auto field = [](const std::string &line, const char *key) -> const char * {
+    std::string pattern = std::string("\"") + key + "\": ";
+    size_t at = line.find(pattern);
+    return at == std::string::npos ? nullptr : line.c_str() + at + pattern.size();
+  };
+  std::string line;
+  messages = 0;
+  while (std::getline(file, line)) {
+    if (const char *value = field(line, "messages")) {
+      messages = std::strtoull(value, nullptr, 10);
+    }
+    const char *workload = field(line, "workload");
+    const char *book = field(line, "book");
+    const char *throughput = field(line, "msgs_per_sec");
+    const char *p99 = field(line, "p99_ns");
+    if (!workload || !book || !throughput || !p99) continue;
+    Result result;
+    result.workload = std::string(workload + 1, std::strchr(workload + 1, '"'));
+    result.book = std::string(book + 1, std::strchr(book + 1, '"'));
+    result.msgs_per_sec.median = std::strtod(throughput, nullptr);
+    result.p99_ns.median = std::strtod(p99, nullptr);
+    results.push_back(result);
+  }
+  return true;
+}
+
+// Prints every regression against the baseline, and every case only one
+// side has: a case this run measured that the baseline lacks, or a
+// baseline case in the --books/--workloads selection that this run no
+// longer produces. Returns how many of either.
+int Compare(const Options &options, const std::vector<Result> &results,
+            const std::vector<Result> &baseline) {
+  int failures = 0;
+  auto same_case = [](const Result &a, const Result &b) {
+    return a.workload == b.workload && a.book == b.book;
+  };
+  for (const Result &r : results) {
+    auto b = std::find_if(baseline.begin(), baseline.end(),
+                          [&](const Result &b) { return same_case(r, b); });
+    if (b == baseline.end()) {
+      std::printf("  %-13s %-3s not in the baseline  MISSING\n",
+                  r.workload.c_str(), r.book.c_str());
+      ++failures;
+      continue;
+    }
+    double throughput_change =
+        (r.msgs_per_sec.median / b->msgs_per_sec.median - 1) * 100;
+    double p99_change = (r.p99_ns.median / b->p99_ns.median - 1) * 100;
+    bool slower = -throughput_change > options.max_throughput_drop_pct;
+    bool laggier = p99_change > options.max_p99_rise_pct;
+    std::printf("  %-13s %-3s throughput %+6.1f%%  p99 %+6.1f%%%s\n",
+                r.workload.c_str(), r.book.c_str(), throughput_change,
+                p99_change, slower || laggier ? "  REGRESSION" : "");
+    if (slower || laggier) ++failures;
+  }
+  for (const Result &b : baseline) {
+    if (!Contains(options.workloads, b.workload) ||
+        !Contains(options.books, b.book)) {
+      continue;
+    }
+    if (std::none_of(results.begin(), results.end(),
+                     [&](const Result &r) { return same_case(r, b); })) {
+      std::printf("  %-13s %-3s in the baseline but not run  MISSING\n",
+                  b.workload.c_str(), b.book.c_str());
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+int main(int argc, char *argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!value) {
+      std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+      return 2;
+    }
+    ++i;
+    if (arg == "--runs") {
+      options.runs = std::max(1, std::atoi(value));
+    } else if (arg == "--messages") {
+      options.messages = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--preseed") {
+      options.preseed = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--data-dir") {
+      options.data_dir = value;
+    } else if (arg == "--baseline") {
+      options.baseline = value;
+    } else if (arg == "--write-baseline") {
+      options.write_baseline = value;
+    } else if (arg == "--books") {
+      options.books = SplitList(value);
+    } else if (arg == "--workloads") {
+      options.workloads = SplitList(value);
+    } else if (arg == "--max-throughput-drop") {
+      options.max_throughput_drop_pct = std::atof(value);
+    } else if (arg == "--max-p99-rise") {
+      options.max_p99_rise_pct = std::atof(value);
+    } else {
+      std::fprintf(stderr,
+                   "Usage: %s [--runs N] [--messages N] [--preseed N]"
+                   " [--data-dir DIR] [--books v1,v1flat,v3,v4,v6]"
+                   " [--workloads dense,...] [--baseline FILE]"
+                   " [--write-baseline FILE] [--max-throughput-drop PCT]"
+                   " [--max-p99-rise PCT]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  mkdir(options.data_dir.c_str(), 0755);
+  const std::string bin_dir = SelfDirectory();
+  std::vector<Result> results;
+
+  std::printf("%-13s %-6s %-32s %s\n", "workload", "book",
+              "msgs/s median [95% CI]", "p99 ns median [95% CI]");
+  for (const WorkloadSpec &spec : WORKLOADS) {
+    if (!Contains(options.workloads, spec.name)) continue;
+    std::string data = options.data_dir + "/" + spec.name + "_" +
+                       std::to_string(options.messages) + "_" +
+                       std::to_string(options.preseed) + ".csv";
+    if (access(data.c_str(), R_OK) != 0 &&
+        !WriteWorkload(data, GenerateWorkload(spec, options.messages,
+                                              options.preseed))) {
+      return 2;
+    }
+
+    for (const char *book : BOOKS) {
+      if (!Contains(options.books, book)) continue;
+      std::string driver = bin_dir + "/bench_book_" + book;
+      std::vector<double> throughput, p99;
+      for (int run = 0; run < options.runs; ++run) {
+        double ms, p99_ns;
+        size_t messages;
+        if (!RunDriver(driver, data, ms, p99_ns, messages)) {
+          std::fprintf(stderr, "%s failed on %s\n", driver.c_str(), data.c_str());
+          return 2;
+        }
+        throughput.push_back(messages / ms * 1000.0);
+        p99.push_back(p99_ns);
+      }
+      Result result{spec.name, book, Estimate95(throughput), Estimate95(p99)};
+      std::printf("%-13s %-6s %9.0f [%9.0f, %9.0f] %6.0f [%6.0f, %6.0f]\n",
+                  spec.name, book, result.msgs_per_sec.median,
+                  result.msgs_per_sec.low, result.msgs_per_sec.high,
+                  result.p99_ns.median, result.p99_ns.low, result.p99_ns.high);
+      std::fflush(stdout);
+      results.push_back(result);
+    }
+  }
+
+  if (!options.write_baseline.empty() &&
+      !WriteResults(options.write_baseline, options, results)) {
+    return 2;
+  }
+  if (options.baseline.empty()) return 0;
+
+  std::vector<Result> baseline;
+  size_t baseline_messages;
+  if (!ReadResults(options.baseline, baseline, baseline_messages)) return 2;
+  if (baseline_messages != options.messages) {
+    std::fprintf(stderr, "baseline was recorded with --messages %zu\n",
+                 baseline_messages);
+    return 2;
+  }
+  std::printf("Against %s (max throughput drop %.0f%%, max p99 rise %.0f%%):\n",
+              options.baseline.c_str(), options.max_throughput_drop_pct,
+              options.max_p99_rise_pct);
+  int failures = Compare(options, results, baseline);
+  if (failures > 0) {
+    std::printf("%d regression(s) or missing case(s)\n", failures);
+    return 1;
+  }
+  std::printf("No regressions\n");
+  return 0;
+}
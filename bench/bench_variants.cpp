@@ -0,0 +1,208 @@
+#include "Workloads.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Optimization matrix: replays the suite's workloads (Workloads.h) through
+// several builds of orderbook_v6, given as NAME=BINARY, and tabulates the
+// median match-phase time of each (orderbook_v6 --json) with its speedup
+// over the first build. Runs are interleaved across builds so drift in the
+// machine hits every column alike.
+//
+// The builds must agree on the outcome: each one replays every workload
+// once with --state-hash first, and the exit status is 1 if any final
+// book differs from the first build's.
+//
+// cmake/OptimizationMatrix.cmake builds the variants; the root project's
+// bench target runs both.
+
+struct Options {
+  int runs = 5;
+  size_t messages = 1000000;
+  size_t preseed = 20000;
+  std::string data_dir = "bench_data";
+  std::vector<std::string> workloads;
+};
+
+struct Variant {
+  std::string name;
+  std::string binary;
+};
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+std::vector<std::string> SplitList(const char *list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) items.push_back(item);
+  }
+  return items;
+}
+
+// Runs `binary flag data` and returns everything it printed, or false if
+// it failed.
+bool Capture(const std::string &binary, const char *flag,
+             const std::string &data, std::string &output) {
+  std::string command =
+      "'" + binary + "' " + flag + " '" + data + "' 2>/dev/null";
+  FILE *pipe = popen(command.c_str(), "r");
+  if (!pipe) return false;
+  output.clear();
+  char buffer[4096];
+  size_t n;
+  while ((n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+    output.append(buffer, n);
+  }
+  return pclose(pipe) == 0;
+}
+
+bool MatchMs(const Variant &variant, const std::string &data, double &ms) {
+  std::string output;
+  if (!Capture(variant.binary, "--json", data, output)) return false;
+  const char *key = "\"name\": \"match\", \"ms\": ";
+  size_t at = output.find(key);
+  if (at == std::string::npos) return false;
+  ms = std::strtod(output.c_str() + at + std::strlen(key), nullptr);
+  return true;
+}
+
+bool FinalHash(const Variant &variant, const std::string &data,
+               std::string &hash) {
+  std::string output;
+  if (!Capture(variant.binary, "--state-hash", data, output)) return false;
+  const char *key = "State hash: ";
+  size_t at = output.find(key);
+  if (at == std::string::npos) return false;
+  hash = output.substr(at + std::strlen(key), 16);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  Options options;
+  std::vector<Variant> variants;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t equals = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 && equals != std::string::npos) {
+      variants.push_back({arg.substr(0, equals), arg.substr(equals + 1)});
+      continue;
+    }
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    ++i;
+    if (value && arg == "--runs") {
+      options.runs = std::max(1, std::atoi(value));
+    } else if (value && arg == "--messages") {
+      options.messages = std::strtoull(value, nullptr, 10);
+    } else if (value && arg == "--preseed") {
+      options.preseed = std::strtoull(value, nullptr, 10);
+    } else if (value && arg == "--data-dir") {
+      options.data_dir = value;
+    } else if (value && arg == "--workloads") {
+      options.workloads = SplitList(value);
+    } else {
+      variants.clear();
+      break;
+    }
+  }
+  if (variants.empty()) {
+    std::fprintf(stderr,
+                 "Usage: %s [--runs N] [--messages N] [--preseed N]"
+                 " [--data-dir DIR] [--workloads dense,...]"
+                 " NAME=ORDERBOOK_V6 ...\n",
+                 argv[0]);
+    return 2;
+  }
+
+  mkdir(options.data_dir.c_str(), 0755);
+  std::printf("orderbook_v6 match phase, median ms of %d runs over %zu "
+              "messages (speedup over %s)\n",
+              options.runs, options.messages, variants[0].name.c_str());
+  std::printf("%-13s", "workload");
+  for (const Variant &variant : variants) {
+    std::printf(" %17s", variant.name.c_str());
+  }
+  std::printf("\n");
+
+  std::vector<double> log_speedup_sum(variants.size(), 0.0);
+  int workload_count = 0;
+  bool same_state = true;
+  for (const WorkloadSpec &spec : WORKLOADS) {
+    if (!options.workloads.empty() &&
+        std::find(options.workloads.begin(), options.workloads.end(),
+                  spec.name) == options.workloads.end()) {
+      continue;
+    }
+    std::string data = options.data_dir + "/" + spec.name + "_" +
+                       std::to_string(options.messages) + "_" +
+                       std::to_string(options.preseed) + ".csv";
+    if (access(data.c_str(), R_OK) != 0 &&
+        !WriteWorkload(data, GenerateWorkload(spec, options.messages,
+                                              options.preseed))) {
+      return 2;
+    }
+
+    std::vector<std::string> hashes(variants.size());
+    std::vector<std::vector<double>> ms(variants.size());
+    for (size_t v = 0; v < variants.size(); ++v) {
+      if (!FinalHash(variants[v], data, hashes[v])) {
+        std::fprintf(stderr, "%s failed on %s\n", variants[v].binary.c_str(),
+                     data.c_str());
+        return 2;
+      }
+    }
+    for (int run = 0; run < options.runs; ++run) {
+      for (size_t v = 0; v < variants.size(); ++v) {
+        double run_ms;
+        if (!MatchMs(variants[v], data, run_ms)) {
+          std::fprintf(stderr, "%s failed on %s\n",
+                       variants[v].binary.c_str(), data.c_str());
+          return 2;
+        }
+        ms[v].push_back(run_ms);
+      }
+    }
+
+    std::printf("%-13s", spec.name);
+    const double reference = Median(ms[0]);
+    for (size_t v = 0; v < variants.size(); ++v) {
+      const double median = Median(ms[v]);
+      log_speedup_sum[v] += std::log(reference / median);
+      char cell[64];
+      std::snprintf(cell, sizeof(cell), "%.1f (%.2fx)%s", median,
+                    reference / median, hashes[v] == hashes[0] ? "" : "!");
+      std::printf(" %17s", cell);
+      same_state &= hashes[v] == hashes[0];
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+    workload_count++;
+  }
+
+  if (workload_count == 0) return 2;
+  std::printf("%-13s", "geomean");
+  for (double sum : log_speedup_sum) {
+    char cell[64];
+    std::snprintf(cell, sizeof(cell), "%.2fx", std::exp(sum / workload_count));
+    std::printf(" %17s", cell);
+  }
+  std::printf("\n");
+  if (!same_state) {
+    std::printf("Builds marked ! end in a different book state than %s\n",
+                variants[0].name.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,308 @@
+#include "Workloads.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Multi-threaded replacement for scripts/generate_data_*.py, for datasets
+// up to billions of messages. The defaults reproduce generate_data_dense.py
+// (prices ~ N(10000, 25), 45% cancels, 50k preseeded orders);
+// `--dist sparse` is generate_data_sparse.py.
+//
+// The only sequential part is deciding, per message, add vs cancel and
+// which live order a cancel hits. Everything else (side, price, quantity,
+// formatting) is generated per BLOCK messages from a seed derived from the
+// run seed and the block number, on as many threads as asked for, so the
+// output is the same for any thread count. Messages are produced a chunk
+// of 2 blocks per thread (at least MIN_CHUNK_BLOCKS) at a time, so memory
+// stays flat however many are asked for.
+constexpr size_t BLOCK = 65536;
+constexpr size_t MIN_CHUNK_BLOCKS = 16;
+
+enum class PriceDist { NORMAL, SPARSE, HEAVY };
+
+struct GeneratorOptions {
+  uint64_t messages = 2000000;
+  uint64_t preseed = 50000;
+  PriceDist dist = PriceDist::NORMAL;
+  double mid = 10000;
+  double spread = 25;      // stddev (normal) or scale (heavy)
+  double drift = 0;        // stddev of the mid's step per BLOCK messages
+  uint64_t sparse_max = 20000;
+  uint64_t max_price = 24999;
+  double cancel_ratio = 0.45;
+  double marketable_ratio = 0;
+  uint32_t symbols = 1;
+  uint64_t max_active = 0; // 0: unbounded
+  uint64_t seed = 1;
+  unsigned threads = 0;    // 0: hardware_concurrency
+  bool binary = false;
+};
+
+// What the sequential pass decides for one message.
+struct PlannedMessage {
+  uint64_t order_id;
+  uint32_t symbol;
+  bool cancel;
+};
+
+struct LiveOrder {
+  uint64_t order_id;
+  uint32_t symbol;
+};
+
+uint64_t BlockSeed(uint64_t seed, uint64_t block) {
+  WorkloadRng mix(seed * 0x9E3779B97F4A7C15ULL + block);
+  return mix.Next();
+}
+
+char *AppendUnsigned(char *out, uint64_t value) {
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  while (n > 0) *out++ = digits[--n];
+  return out;
+}
+
+class Generator {
+public:
+  explicit Generator(const GeneratorOptions &options)
+      : options_(options), plan_rng_(options.seed), drift_rng_(~options.seed),
+        mids_(options.symbols, options.mid) {}
+
+  bool Run(FILE *out) {
+    unsigned threads = options_.threads ? options_.threads
+                                        : std::max(1u, std::thread::hardware_concurrency());
+    const uint64_t total = options_.preseed + options_.messages;
+    const size_t chunk_blocks = std::max<size_t>(MIN_CHUNK_BLOCKS, 2 * threads);
+    const uint64_t chunk = chunk_blocks * BLOCK;
+    std::vector<PlannedMessage> plan;
+    std::vector<std::string> blocks(chunk_blocks);
+    std::vector<std::vector<double>> block_mids(chunk_blocks);
+
+    for (uint64_t chunk_start = 0; chunk_start < total; chunk_start += chunk) {
+      const uint64_t count = std::min<uint64_t>(chunk, total - chunk_start);
+      Plan(chunk_start, count, plan);
+
+      const size_t block_count = (count + BLOCK - 1) / BLOCK;
+      for (size_t b = 0; b < block_count; ++b) {
+        block_mids[b] = mids_;
+        for (double &mid : mids_) {
+          if (options_.drift > 0) mid += drift_rng_.Normal(0, options_.drift);
+          mid = std::clamp(mid, 1.0, static_cast<double>(options_.max_price));
+        }
+      }
+
+      std::atomic<size_t> next_block{0};
+      auto worker = [&]() {
+        for (size_t b; (b = next_block.fetch_add(1)) < block_count;) {
+          size_t begin = b * BLOCK;
+          size_t end = std::min<size_t>(begin + BLOCK, count);
+          FormatBlock(chunk_start / BLOCK + b, block_mids[b], &plan[begin],
+                      end - begin, blocks[b]);
+        }
+      };
+      std::vector<std::thread> pool;
+      for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+      worker();
+      for (std::thread &thread : pool) thread.join();
+
+      for (size_t b = 0; b < block_count; ++b) {
+        if (std::fwrite(blocks[b].data(), 1, blocks[b].size(), out) !=
+            blocks[b].size()) {
+          std::perror("fwrite");
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+private:
+  void Plan(uint64_t chunk_start, uint64_t count,
+            std::vector<PlannedMessage> &plan) {
+    plan.resize(count);
+    for (uint64_t i = 0; i < count; ++i) {
+      bool cancel = false;
+      if (chunk_start + i >= options_.preseed && !active_.empty()) {
+        cancel = (options_.max_active && active_.size() >= options_.max_active) ||
+                 plan_rng_.Unit() < options_.cancel_ratio;
+      }
+      if (cancel) {
+        size_t index = plan_rng_.Next() % active_.size();
+        plan[i] = {active_[index].order_id, active_[index].symbol, true};
+        active_[index] = active_.back();
+        active_.pop_back();
+      } else {
+        uint32_t symbol = options_.symbols > 1
+                              ? static_cast<uint32_t>(plan_rng_.Next() % options_.symbols)
+                              : 0;
+        plan[i] = {next_id_, symbol, false};
+        active_.push_back({next_id_, symbol});
+        ++next_id_;
+      }
+    }
+  }
+
+  uint64_t Price(WorkloadRng &rng, double mid, bool buy, bool marketable) const {
+    double price;
+    if (options_.dist == PriceDist::SPARSE) {
+      if (marketable) return buy ? options_.sparse_max : 1;
+      return rng.Uniform(1, options_.sparse_max);
+    }
+    if (marketable) {
+      price = buy ? mid + 4 * options_.spread : mid - 4 * options_.spread;
+    } else if (options_.dist == PriceDist::HEAVY) {
+      // Student's t with 3 degrees of freedom.
+      double z1 = rng.Normal(0, 1), z2 = rng.Normal(0, 1), z3 = rng.Normal(0, 1);
+      double t = rng.Normal(0, 1) / std::sqrt((z1 * z1 + z2 * z2 + z3 * z3) / 3);
+      price = mid + options_.spread * t;
+    } else {
+      price = rng.Normal(mid, options_.spread);
+    }
+    price = std::clamp(price, 1.0, static_cast<double>(options_.max_price));
+    return static_cast<uint64_t>(price);
+  }
+
+  void FormatBlock(uint64_t block, const std::vector<double> &mids,
+                   const PlannedMessage *plan, size_t count,
+                   std::string &out) const {
+    WorkloadRng rng(BlockSeed(options_.seed, block));
+    out.resize(count * (options_.binary ? sizeof(BinaryWorkloadRecord) : 96));
+    char *ptr = &out[0];
+    for (size_t i = 0; i < count; ++i) {
+      const PlannedMessage &msg = plan[i];
+      char type = 'C', side = 'B';
+      uint64_t price = 0, quantity = 0;
+      if (!msg.cancel) {
+        type = 'A';
+        bool buy = rng.Next() & 1;
+        side = buy ? 'B' : 'S';
+        bool marketable = options_.marketable_ratio > 0 &&
+                          rng.Unit() < options_.marketable_ratio;
+        price = Price(rng, mids[msg.symbol], buy, marketable);
+        quantity = rng.Uniform(1, 100);
+      }
+
+      if (options_.binary) {
+        BinaryWorkloadRecord record{msg.order_id,
+                                    static_cast<uint32_t>(price),
+                                    static_cast<uint32_t>(quantity),
+                                    msg.symbol, type, side, {0, 0}};
+        std::memcpy(ptr, &record, sizeof(record));
+        ptr += sizeof(record);
+        continue;
+      }
+      *ptr++ = type;
+      *ptr++ = ',';
+      *ptr++ = side;
+      *ptr++ = ',';
+      ptr = AppendUnsigned(ptr, msg.order_id);
+      *ptr++ = ',';
+      ptr = AppendUnsigned(ptr, price);
+      *ptr++ = ',';
+      ptr = AppendUnsigned(ptr, quantity);
+      if (options_.symbols > 1) {
+        *ptr++ = ',';
+        ptr = AppendUnsigned(ptr, msg.symbol);
+      }
+      *ptr++ = '\n';
+    }
+    out.resize(ptr - &out[0]);
+  }
+
+  GeneratorOptions options_;
+  WorkloadRng plan_rng_;
+  WorkloadRng drift_rng_;
+  std::vector<double> mids_;
+  std::vector<LiveOrder> active_;
+  uint64_t next_id_ = 1;
+};
+
+int main(int argc, char *argv[]) {
+  GeneratorOptions options;
+  const char *output = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : "";
+    bool takes_value = true;
+    if (arg == "--messages") {
+      options.messages = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--preseed") {
+      options.preseed = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--dist") {
+      std::string dist = value;
+      if (dist == "normal") options.dist = PriceDist::NORMAL;
+      else if (dist == "sparse") options.dist = PriceDist::SPARSE;
+      else if (dist == "heavy") options.dist = PriceDist::HEAVY;
+      else output = nullptr, i = argc;
+    } else if (arg == "--mid") {
+      options.mid = std::atof(value);
+    } else if (arg == "--spread") {
+      options.spread = std::atof(value);
+    } else if (arg == "--drift") {
+      options.drift = std::atof(value);
+    } else if (arg == "--sparse-max") {
+      options.sparse_max = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--max-price") {
+      options.max_price = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--cancel-ratio") {
+      options.cancel_ratio = std::atof(value);
+    } else if (arg == "--marketable") {
+      options.marketable_ratio = std::atof(value);
+    } else if (arg == "--symbols") {
+      options.symbols = std::max(1, std::atoi(value));
+    } else if (arg == "--max-active") {
+      options.max_active = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--seed") {
+      options.seed = std::strtoull(value, nullptr, 10);
+    } else if (arg == "--threads") {
+      options.threads = static_cast<unsigned>(std::atoi(value));
+    } else if (arg == "--format") {
+      std::string format = value;
+      if (format == "csv") options.binary = false;
+      else if (format == "binary") options.binary = true;
+      else output = nullptr, i = argc;
+    } else {
+      takes_value = false;
+      output = arg[0] != '-' && !output ? argv[i] : nullptr;
+      if (!output) break;
+    }
+    if (takes_value) ++i;
+  }
+  if (!output) {
+    std::fprintf(stderr,
+                 "Usage: %s [--messages N] [--preseed N]"
+                 " [--dist normal|sparse|heavy] [--mid P] [--spread S]"
+                 " [--drift D] [--sparse-max P] [--max-price P]"
+                 " [--cancel-ratio R] [--marketable R] [--symbols N]"
+                 " [--max-active N] [--seed S] [--threads N]"
+                 " [--format csv|binary] <output>\n",
+                 argv[0]);
+    return 1;
+  }
+
+  FILE *out = std::fopen(output, "wb");
+  if (!out) {
+    std::perror(output);
+    return 1;
+  }
+  auto start = std::chrono::steady_clock::now();
+  bool ok = Generator(options).Run(out);
+  ok = std::fclose(out) == 0 && ok;
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  std::fprintf(stderr, "%llu messages to %s in %.2f s\n",
+               (unsigned long long)(options.preseed + options.messages), output,
+               seconds);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+# Flags for the tuned books (V4, V6) and their bench drivers. The root
+# project's bench, orderbook_v6_pgo and orderbook_v6_bolt targets rebuild
+# orderbook_v6 in separate build trees with other values
+# (cmake/OptimizationMatrix.cmake).
+set(ORDERBOOK_OPT_FLAGS "-O3 -march=native -flto" CACHE STRING
+    "Compile flags of the V4/V6 books (-DNDEBUG is always added)")
+set(ORDERBOOK_LINK_FLAGS "-flto" CACHE STRING
+    "Link flags of the V4/V6 books")
@@ -0,0 +1,143 @@
+# Builds orderbook_v6 once per optimization variant, each in its own build
+# tree VARIANT_DIR/<name> configured from V6/ with that variant's
+# ORDERBOOK_OPT_FLAGS and ORDERBOOK_LINK_FLAGS, and the calling tree's
+# CMAKE_BUILD_TYPE (BUILD_TYPE, may be empty). Run with cmake -P by the
+# root project's bench, orderbook_v6_pgo and orderbook_v6_bolt targets,
+# which pass the -D values read below.
+#
+#   o2, o3, native  -O2; -O3; -O3 -march=native
+#   lto             -O3 -march=native -flto, the default build
+#   pgo             lto in two stages: built with -fprofile-generate,
+#                   replayed over the training data, then rebuilt in the
+#                   same tree (so the .gcda files line up with the objects)
+#                   with -fprofile-use. GCC only.
+#   bolt            the pgo binary instrumented by llvm-bolt, replayed over
+#                   the training data and laid out again from that profile
+#
+# The training data is generated by generate_workload with seeds and shapes
+# of its own: dense, sparse, heavy-tailed with marketable orders, and
+# cancel-heavy. The suite workloads the matrix is measured on
+# (bench_variants) are never replayed during training.
+cmake_minimum_required(VERSION 3.16)
+
+foreach(var SOURCE_DIR VARIANT_DIR CXX_COMPILER CXX_COMPILER_ID GENERATOR
+            TRAINING_MESSAGES VARIANTS)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "OptimizationMatrix.cmake needs -D${var}=...")
+    endif()
+endforeach()
+string(REPLACE "," ";" VARIANTS "${VARIANTS}")
+
+set(LTO_FLAGS "-O3 -march=native -flto")
+# BOLT needs the relocations kept in the binary it rewrites.
+if(BOLT)
+    set(PGO_LINK_EXTRA "-Wl,--emit-relocs")
+endif()
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        string(REPLACE ";" " " command "${ARGN}")
+        message(FATAL_ERROR "${command} failed: ${result}")
+    endif()
+endfunction()
+
+function(build_variant name opt_flags link_flags)
+    message(STATUS "orderbook_v6 ${name}: ${opt_flags} | link: ${link_flags}")
+    set(dir ${VARIANT_DIR}/${name})
+    run(${CMAKE_COMMAND} -S ${SOURCE_DIR}/V6 -B ${dir}
+        -DCMAKE_CXX_COMPILER=${CXX_COMPILER}
+        "-DCMAKE_BUILD_TYPE=${BUILD_TYPE}"
+        "-DORDERBOOK_OPT_FLAGS=${opt_flags}"
+        "-DORDERBOOK_LINK_FLAGS=${link_flags}")
+    run(${CMAKE_COMMAND} --build ${dir} --target orderbook_v6)
+endfunction()
+
+# Generated once per TRAINING_MESSAGES and reused.
+set(TRAINING_DIR ${VARIANT_DIR}/training)
+set(TRAINING_FILES "")
+function(training_set shape seed)
+    set(file ${TRAINING_DIR}/${shape}_${TRAINING_MESSAGES}.csv)
+    if(NOT EXISTS ${file})
+        file(MAKE_DIRECTORY ${TRAINING_DIR})
+        run(${GENERATOR} --messages ${TRAINING_MESSAGES} --seed ${seed} ${ARGN}
+            ${file})
+    endif()
+    set(TRAINING_FILES ${TRAINING_FILES} ${file} PARENT_SCOPE)
+endfunction()
+
+function(train binary)
+    foreach(file ${TRAINING_FILES})
+        message(STATUS "training ${binary} on ${file}")
+        execute_process(COMMAND ${binary} ${file} RESULT_VARIABLE result
+                        OUTPUT_QUIET)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${binary} failed on ${file}: ${result}")
+        endif()
+    endforeach()
+endfunction()
+
+if("pgo" IN_LIST VARIANTS OR "bolt" IN_LIST VARIANTS)
+    training_set(dense 101)
+    training_set(sparse 102 --dist sparse)
+    training_set(heavy 103 --dist heavy --marketable 0.02)
+    training_set(cancel_heavy 104 --cancel-ratio 0.9)
+endif()
+
+foreach(variant ${VARIANTS})
+    if(variant STREQUAL "o2")
+        build_variant(o2 "-O2" "")
+    elseif(variant STREQUAL "o3")
+        build_variant(o3 "-O3" "")
+    elseif(variant STREQUAL "native")
+        build_variant(native "-O3 -march=native" "")
+    elseif(variant STREQUAL "lto")
+        build_variant(lto "${LTO_FLAGS}" "-flto")
+    elseif(variant STREQUAL "pgo")
+        if(NOT CXX_COMPILER_ID STREQUAL "GNU")
+            message(FATAL_ERROR "the pgo variant uses GCC's -fprofile-generate/-fprofile-use")
+        endif()
+        file(GLOB_RECURSE stale_profiles ${VARIANT_DIR}/pgo/*.gcda)
+        if(stale_profiles)
+            file(REMOVE ${stale_profiles})
+        endif()
+        build_variant(pgo "${LTO_FLAGS} -fprofile-generate -fprofile-update=single"
+                      "-flto -fprofile-generate")
+        train(${VARIANT_DIR}/pgo/orderbook_v6)
+        # Code the training never reached is still optimized for speed.
+        build_variant(pgo
+            "${LTO_FLAGS} -fprofile-use -fprofile-partial-training -Wno-missing-profile"
+            "-flto -fprofile-use ${PGO_LINK_EXTRA}")
+    elseif(variant STREQUAL "bolt")
+        if(NOT BOLT OR NOT MERGE_FDATA)
+            message(FATAL_ERROR "the bolt variant needs llvm-bolt and merge-fdata")
+        endif()
+        if(NOT EXISTS ${VARIANT_DIR}/pgo/orderbook_v6)
+            message(FATAL_ERROR "the bolt variant rewrites the pgo build; list pgo first")
+        endif()
+        set(dir ${VARIANT_DIR}/bolt)
+        file(MAKE_DIRECTORY ${dir})
+        file(GLOB stale_profiles ${dir}/*.fdata*)
+        if(stale_profiles)
+            file(REMOVE ${stale_profiles})
+        endif()
+        run(${BOLT} ${VARIANT_DIR}/pgo/orderbook_v6 -instrument
+            -instrumentation-file=${dir}/profile.fdata
+            -instrumentation-file-append-pid
+            -o ${dir}/orderbook_v6.instrumented)
+        train(${dir}/orderbook_v6.instrumented)
+        file(GLOB profiles ${dir}/profile.fdata.*)
+        execute_process(COMMAND ${MERGE_FDATA} ${profiles}
+                        OUTPUT_FILE ${dir}/profile.fdata RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "merge-fdata failed: ${result}")
+        endif()
+        message(STATUS "orderbook_v6 bolt: pgo binary relaid out by llvm-bolt")
+        run(${BOLT} ${VARIANT_DIR}/pgo/orderbook_v6 -o ${dir}/orderbook_v6
+            -data=${dir}/profile.fdata -reorder-blocks=ext-tsp
+            -reorder-functions=hfsort -split-functions -split-all-cold
+            -dyno-stats)
+    else()
+        message(FATAL_ERROR "unknown variant ${variant}")
+    endif()
+endforeach()
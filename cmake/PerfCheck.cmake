@@ -0,0 +1,21 @@
+# Runs bench_runner (RUNNER) against the baseline recorded in the build
+# tree (BASELINE) by the perf_baseline target. A missing baseline fails
+# the check, so a fresh build can't pass it by comparing against nothing;
+# ALLOW_NO_BASELINE (PERF_CHECK_ALLOW_NO_BASELINE=ON) skips it instead.
+cmake_minimum_required(VERSION 3.16)
+
+if(NOT EXISTS ${BASELINE})
+    if(ALLOW_NO_BASELINE)
+        message(STATUS "perf_check skipped: no baseline at ${BASELINE} "
+                       "(PERF_CHECK_ALLOW_NO_BASELINE is ON)")
+        return()
+    endif()
+    message(FATAL_ERROR "perf_check: no baseline at ${BASELINE}; build "
+                        "perf_baseline on this machine first, or configure "
+                        "with -DPERF_CHECK_ALLOW_NO_BASELINE=ON to skip")
+endif()
+execute_process(COMMAND ${RUNNER} --baseline ${BASELINE}
+                RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "perf_check failed against ${BASELINE}: ${result}")
+endif()
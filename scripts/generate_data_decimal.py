@@ -0,0 +1,75 @@
+import csv
+import random
+
+# --- Configuration ---
+NUM_MESSAGES = 2_000_000
+PRESEED_ORDERS = 50_000
+ADD_RATIO = 0.55
+OUTPUT_FILE = 'market_data_decimal.csv'
+
+# Tick schedule of the demo instrument, in cents. Must match kDemoTickTable
+# in V6/src/main_decimal_v6.cpp: 0.01 below 100.00, 0.05 up to 500.00.
+TICK_TIERS = [(0, 1), (10000, 5)]
+MAX_PRICE_CENTS = 50000
+
+# Prices cluster around 100.00, so the book straddles the tick-size change.
+
+
+def snap_to_tick(cents):
+    cents = max(1, min(cents, MAX_PRICE_CENTS))
+    tick_from, tick = TICK_TIERS[0]
+    for tier_from, tier_tick in TICK_TIERS:
+        if cents >= tier_from:
+            tick_from, tick = tier_from, tier_tick
+    return tick_from + (cents - tick_from) // tick * tick
+
+
+def generate_price():
+    cents = snap_to_tick(int(random.gauss(10000, 40)))
+    return f"{cents // 100}.{cents % 100:02d}"
+
+# --- Main Generation Logic (re-used from dense script) ---
+
+
+def generate_data(filename, price_generator):
+    print(f"Generating data for {filename}...")
+    active_orders = []
+    order_id_counter = 1
+
+    with open(filename, 'w', newline='') as f:
+        writer = csv.writer(f)
+
+        # 1. Pre-seed the book
+        for _ in range(PRESEED_ORDERS):
+            side = random.choice(['B', 'S'])
+            price = price_generator()
+            quantity = random.randint(1, 100)
+            writer.writerow(['A', side, order_id_counter, price, quantity])
+            active_orders.append(order_id_counter)
+            order_id_counter += 1
+
+        # 2. Generate the main body of messages
+        for i in range(NUM_MESSAGES):
+            if (i % 200000 == 0):
+                print(f"  ... {i / NUM_MESSAGES * 100:.0f}% complete")
+
+            if random.random() < ADD_RATIO or not active_orders:
+                # Add Order
+                side = random.choice(['B', 'S'])
+                price = price_generator()
+                quantity = random.randint(1, 100)
+                writer.writerow(['A', side, order_id_counter, price, quantity])
+                active_orders.append(order_id_counter)
+                order_id_counter += 1
+            else:
+                # Cancel Order
+                order_to_cancel = random.choice(active_orders)
+                active_orders.remove(order_to_cancel)
+                writer.writerow(['C', 'B', order_to_cancel, 0, 0])
+
+    print(f"Finished generating {filename} with "
+          f"{order_id_counter - 1} total orders.")
+
+
+if __name__ == '__main__':
+    generate_data(OUTPUT_FILE, generate_price)